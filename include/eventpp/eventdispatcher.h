@@ -24,6 +24,7 @@
 #include <mutex>
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace eventpp {
 
@@ -111,12 +112,22 @@ protected:
 		std::function<ReturnType (Args...)>
 	>::Type;
 	using CallbackList_ = CallbackList<ReturnType (Args...), Policies>;
+	// The map holds the callback lists by shared pointer, so an empty list can be
+	// erased from the map while other threads are still dispatching on it.
+	using CallbackListPtr = std::shared_ptr<CallbackList_>;
+	using ConstCallbackListPtr = std::shared_ptr<const CallbackList_>;
+
+	// Dispatching uses a raw pointer to the callback list, the lists erased during dispatching are retired
+	// and released when no dispatching is running. This avoids the atomic reference counting of the shared pointer
+	// on each dispatching. With SingleThreading, only the listeners can erase a callback list during dispatching,
+	// so a plain depth counter is enough. Otherwise the count of the running dispatchings is atomic.
+	using IsSingleThreading = std::is_same<Threading, SingleThreading>;
 
 	using Prototype = ReturnType (Args...);
 
 	using Map = typename SelectMap<
 		EventType,
-		CallbackList_,
+		CallbackListPtr,
 		Policies,
 		HasTemplateMap<Policies>::value
 	>::Type;
@@ -135,7 +146,11 @@ public:
 	EventDispatcherBase()
 		:
 			eventCallbackListMap(),
-			listenerMutex()
+			listenerMutex(),
+			dispatchingDepth(0),
+			dispatchingCount(0),
+			hasRetiredCallableList(false),
+			retiredCallableListList()
 	{
 	}
 
@@ -147,28 +162,29 @@ public:
 	{
 		std::lock_guard<Mutex> lockGuard(listenerMutex);
 
-		return eventCallbackListMap[event].append(callback);
+		return doGetCallableList(event).append(callback);
 	}
 
 	Handle prependListener(const Event & event, const Callback & callback)
 	{
 		std::lock_guard<Mutex> lockGuard(listenerMutex);
 
-		return eventCallbackListMap[event].prepend(callback);
+		return doGetCallableList(event).prepend(callback);
 	}
 
 	Handle insertListener(const Event & event, const Callback & callback, const Handle before)
 	{
 		std::lock_guard<Mutex> lockGuard(listenerMutex);
 
-		return eventCallbackListMap[event].insert(callback, before);
+		return doGetCallableList(event).insert(callback, before);
 	}
 
 	bool removeListener(const Event & event, const Handle handle)
 	{
-		CallbackList_ * callableList = doFindCallableList(event);
-		if(callableList) {
-			return callableList->remove(handle);
+		CallbackListPtr callableList = doFindCallableList(event);
+		if(callableList && callableList->remove(handle)) {
+			doEraseEmptyCallableList(event, callableList);
+			return true;
 		}
 
 		return false;
@@ -177,7 +193,7 @@ public:
 	template <typename Func>
 	void forEach(const Event & event, Func && func) const
 	{
-		const CallbackList_ * callableList = doFindCallableList(event);
+		ConstCallbackListPtr callableList = doFindCallableList(event);
 		if(callableList) {
 			callableList->forEach(std::forward<Func>(func));
 		}
@@ -186,7 +202,7 @@ public:
 	template <typename Func>
 	bool forEachIf(const Event & event, Func && func) const
 	{
-		const CallbackList_ * callableList = doFindCallableList(event);
+		ConstCallbackListPtr callableList = doFindCallableList(event);
 		if (callableList) {
 			return callableList->forEachIf(std::forward<Func>(func));
 		}
@@ -220,23 +236,30 @@ public:
 protected:
 	void doDispatch(const Event & e, Args ...args) const
 	{
-		if(! internal_::ForEachMixins<MixinRoot, Mixins, DoMixinBeforeDispatch>::forEach(
-			this, typename std::add_lvalue_reference<Args>::type(args)...)) {
-			return;
-		}
-
-		const CallbackList_ * callableList = doFindCallableList(e);
-		if(callableList) {
-			(*callableList)(std::forward<Args>(args)...);
-		}
+		using MixinChain = internal_::MixinDispatchChain<MixinRoot, Mixins>;
+
+		MixinChain::invoke(this, [this, &e, &args...]() {
+			// If any mixin has mixinAfterDispatch, the arguments must not be moved to the listeners.
+			doDispatchCallableList(
+				IsSingleThreading(),
+				std::integral_constant<
+					bool,
+					MixinChain::template HasAfterDispatch<Event, typename std::add_lvalue_reference<Args>::type...>::value
+				>(),
+				e,
+				args...
+			);
+		}, e, args...);
 	}
 
-	const CallbackList_ * doFindCallableList(const Event & e) const
+	// The returned pointer keeps the callback list alive even if the list
+	// is erased from the map by removeListener in another thread.
+	ConstCallbackListPtr doFindCallableList(const Event & e) const
 	{
 		return doFindCallableListHelper(this, e);
 	}
 
-	CallbackList_ * doFindCallableList(const Event & e)
+	CallbackListPtr doFindCallableList(const Event & e)
 	{
 		return doFindCallableListHelper(this, e);
 	}
@@ -245,39 +268,163 @@ private:
 	// template helper to avoid code duplication in doFindCallableList
 	template <typename T>
 	static auto doFindCallableListHelper(T * self, const Event & e)
-		-> typename std::conditional<std::is_const<T>::value, const CallbackList_ *, CallbackList_ *>::type
+		-> typename std::conditional<std::is_const<T>::value, ConstCallbackListPtr, CallbackListPtr>::type
 	{
 		std::lock_guard<Mutex> lockGuard(self->listenerMutex);
 
 		auto it = self->eventCallbackListMap.find(e);
 		if(it != self->eventCallbackListMap.end()) {
-			return &it->second;
+			return it->second;
 		}
 		else {
 			return nullptr;
 		}
 	}
 
-private:
-	// Mixin related
-	struct DoMixinBeforeDispatch
+	struct DispatchingGuard
 	{
-		template <typename T, typename Self, typename ...A>
-		static auto forEach(const Self * self, A && ...args)
-			-> typename std::enable_if<HasFunctionMixinBeforeDispatch<T, A...>::value, bool>::type {
-			return static_cast<const T *>(self)->mixinBeforeDispatch(std::forward<A>(args)...);
+		explicit DispatchingGuard(const EventDispatcherBase * dispatcher) : dispatcher(dispatcher) {
+			++dispatcher->dispatchingDepth;
 		}
 
-		template <typename T, typename Self, typename ...A>
-		static auto forEach(const Self * self, A && ...args)
-			-> typename std::enable_if<! HasFunctionMixinBeforeDispatch<T, A...>::value, bool>::type {
-			return true;
+		~DispatchingGuard() {
+			if(--dispatcher->dispatchingDepth == 0 && ! dispatcher->retiredCallableListList.empty()) {
+				dispatcher->retiredCallableListList.clear();
+			}
+		}
+
+		const EventDispatcherBase * dispatcher;
+	};
+
+	template <typename AfterDispatch>
+	void doDispatchCallableList(
+			std::true_type /*isSingleThreading*/,
+			AfterDispatch afterDispatch,
+			const Event & e,
+			typename std::add_lvalue_reference<Args>::type ...args
+		) const
+	{
+		auto it = eventCallbackListMap.find(e);
+		if(it != eventCallbackListMap.end()) {
+			DispatchingGuard dispatchingGuard(this);
+			doInvokeCallableList(*it->second, afterDispatch, args...);
+		}
+	}
+
+	// The count is increased by the caller with listenerMutex locked, so a list found under the lock
+	// is never released before the count is decreased.
+	struct ConcurrentDispatchingGuard
+	{
+		explicit ConcurrentDispatchingGuard(const EventDispatcherBase * dispatcher) : dispatcher(dispatcher) {
+		}
+
+		~ConcurrentDispatchingGuard() {
+			if(dispatcher->dispatchingCount.fetch_sub(1) == 1 && dispatcher->hasRetiredCallableList.load()) {
+				std::lock_guard<Mutex> lockGuard(dispatcher->listenerMutex);
+				dispatcher->doReleaseRetiredCallableLists();
+			}
 		}
+
+		const EventDispatcherBase * dispatcher;
 	};
 
+	template <typename AfterDispatch>
+	void doDispatchCallableList(
+			std::false_type /*isSingleThreading*/,
+			AfterDispatch afterDispatch,
+			const Event & e,
+			typename std::add_lvalue_reference<Args>::type ...args
+		) const
+	{
+		const CallbackList_ * callableList;
+		{
+			std::lock_guard<Mutex> lockGuard(listenerMutex);
+
+			auto it = eventCallbackListMap.find(e);
+			if(it == eventCallbackListMap.end()) {
+				return;
+			}
+			callableList = it->second.get();
+			dispatchingCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		ConcurrentDispatchingGuard dispatchingGuard(this);
+		doInvokeCallableList(*callableList, afterDispatch, args...);
+	}
+
+	// listenerMutex must be locked by the caller.
+	void doRetireCallableList(CallbackListPtr && callableList)
+	{
+		if(IsSingleThreading::value) {
+			if(dispatchingDepth > 0) {
+				retiredCallableListList.push_back(std::move(callableList));
+			}
+			return;
+		}
+
+		retiredCallableListList.push_back(std::move(callableList));
+		// Pairs with ConcurrentDispatchingGuard, either the last dispatching sees the flag, or the count is seen zero here.
+		hasRetiredCallableList.store(true);
+		doReleaseRetiredCallableLists();
+	}
+
+	// listenerMutex must be locked by the caller.
+	// A dispatching which begins after the lists are retired can't find them, so they are released
+	// once no dispatching is running.
+	void doReleaseRetiredCallableLists() const
+	{
+		if(! retiredCallableListList.empty() && dispatchingCount.load() == 0) {
+			retiredCallableListList.clear();
+			hasRetiredCallableList.store(false);
+		}
+	}
+
+	// listenerMutex must be locked by the caller.
+	CallbackList_ & doGetCallableList(const Event & e)
+	{
+		CallbackListPtr & callableList = eventCallbackListMap[e];
+		if(! callableList) {
+			callableList = std::make_shared<CallbackList_>();
+		}
+		return *callableList;
+	}
+
+	void doEraseEmptyCallableList(const Event & e, const CallbackListPtr & callableList)
+	{
+		if(! callableList->empty()) {
+			return;
+		}
+
+		std::lock_guard<Mutex> lockGuard(listenerMutex);
+
+		// Check again under the lock, another thread may have added listeners,
+		// or have replaced the list after it was erased.
+		auto it = eventCallbackListMap.find(e);
+		if(it != eventCallbackListMap.end() && it->second == callableList && callableList->empty()) {
+			doRetireCallableList(std::move(it->second));
+			eventCallbackListMap.erase(it);
+		}
+	}
+
+	void doInvokeCallableList(const CallbackList_ & callableList, std::true_type, typename std::add_lvalue_reference<Args>::type ...args) const
+	{
+		callableList(args...);
+	}
+
+	void doInvokeCallableList(const CallbackList_ & callableList, std::false_type, typename std::add_lvalue_reference<Args>::type ...args) const
+	{
+		callableList(std::forward<Args>(args)...);
+	}
+
 private:
 	Map eventCallbackListMap;
 	mutable Mutex listenerMutex;
+	// Only used with SingleThreading.
+	mutable int dispatchingDepth;
+	// Not used with SingleThreading.
+	mutable typename Threading::template Atomic<int> dispatchingCount;
+	mutable typename Threading::template Atomic<bool> hasRetiredCallableList;
+	mutable std::vector<CallbackListPtr> retiredCallableListList;
 };
 
 
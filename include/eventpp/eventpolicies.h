@@ -19,6 +19,8 @@
 #include <condition_variable>
 #include <map>
 #include <unordered_map>
+#include <string>
+#include <cstddef>
 
 namespace eventpp {
 
@@ -92,6 +94,11 @@ struct DefaultPolicies
 	template <typename Key, typename T>
 	using Map = std::map <Key, T>;
 	*/
+
+	/* default types for EventQueue
+	template <typename Item, typename Policies>
+	using QueueList = ListQueueList<Item, Policies>;
+	*/
 };
 
 template <template <typename> class ...Args>
@@ -99,6 +106,9 @@ struct MixinList
 {
 };
 
+template <typename T, typename Policies>
+class ListQueueList;
+
 
 namespace internal_ {
 
@@ -177,6 +187,29 @@ template <typename T, bool> struct SelectCanContinueInvoking;
 template <typename T> struct SelectCanContinueInvoking<T, true> { using Type = T; };
 template <typename T> struct SelectCanContinueInvoking<T, false> { using Type = DefaultCanContinueInvoking; };
 
+// The serialization policy functions, used by MixinJournal and MixinRecorder.
+template <typename T, typename ...A>
+struct HasFunctionSerializeEvent
+{
+	template <typename C> static std::true_type test(
+		decltype(C::serializeEvent(std::declval<std::string &>(), std::declval<const A &>()...)) *
+	) ;
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+template <typename T, typename ...A>
+struct HasFunctionDeserializeEvent
+{
+	template <typename C> static std::true_type test(
+		decltype(C::deserializeEvent(std::declval<const char *>(), std::declval<std::size_t>(), std::declval<A &>()...)) *
+	) ;
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
 template <typename T>
 struct HasTemplateMap
 {
@@ -211,6 +244,56 @@ struct SelectMap<Key, Value, T, false> {
 };
 
 
+template <typename T>
+struct HasTemplateQueueList
+{
+	template <typename C> static std::true_type test(typename C::template QueueList<int, DefaultPolicies> *) ;
+	template <typename C> static std::false_type test(...);    
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+template <typename Item, typename T, bool>
+struct SelectQueueList;
+template <typename Item, typename T>
+struct SelectQueueList<Item, T, true>
+{
+	using Type = typename T::template QueueList<Item, T>;
+};
+template <typename Item, typename T>
+struct SelectQueueList<Item, T, false>
+{
+	using Type = eventpp::ListQueueList<Item, T>;
+};
+
+// A queue list adaptor, such as LatencyQueueList, may pass a type derived from the QueuedEvent tuple
+// to the wrapped queue list, the derived type has the member type QueuedEvent.
+// The queue lists which inspect the tuple type use UnwrapQueuedEvent to get the original tuple.
+template <typename T>
+struct HasTypeQueuedEvent
+{
+	template <typename C> static std::true_type test(typename C::QueuedEvent *) ;
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+template <typename T, bool>
+struct SelectUnwrapQueuedEvent;
+template <typename T>
+struct SelectUnwrapQueuedEvent<T, true>
+{
+	using Type = typename T::QueuedEvent;
+};
+template <typename T>
+struct SelectUnwrapQueuedEvent<T, false>
+{
+	using Type = T;
+};
+template <typename T>
+struct UnwrapQueuedEvent
+{
+	using Type = typename SelectUnwrapQueuedEvent<T, HasTypeQueuedEvent<T>::value>::Type;
+};
+
 template <typename T>
 struct HasTypeMixins
 {
@@ -239,45 +322,183 @@ struct InheritMixins <Root, MixinList<> >
 	using Type = Root;
 };
 
-template <typename Root, typename TList, typename Func>
-struct ForEachMixins;
-
-template <typename Func, typename Root, template <typename> class T, template <typename> class ...Args>
-struct ForEachMixins <Root, MixinList<T, Args...>, Func>
+template <typename T, typename ...Args>
+struct HasFunctionMixinBeforeDispatch
 {
-	using Type = typename InheritMixins<Root, MixinList<T, Args...> >::Type;
+	template <typename C> static std::true_type test(
+		decltype(std::declval<C>().mixinBeforeDispatch(std::declval<Args>()...)) *
+	);
+	template <typename C> static std::false_type test(...);    
 
-	template <typename ...A>
-	static bool forEach(A && ...args) {
-		if(Func::template forEach<Type>(std::forward<A>(args)...)) {
-			return ForEachMixins<Root, MixinList<Args...>, Func>::forEach(std::forward<A>(args)...);
-		}
-		return false;
-	}
+	enum { value = !! decltype(test<T>(0))() };
 };
 
-template <typename Root, typename Func>
-struct ForEachMixins <Root, MixinList<>, Func>
+template <typename T, typename ...Args>
+struct HasFunctionMixinBeforeDispatchEvent
 {
-	using Type = Root;
+	template <typename C> static std::true_type test(
+		decltype(std::declval<C>().mixinBeforeDispatchEvent(std::declval<Args>()...)) *
+	);
+	template <typename C> static std::false_type test(...);    
 
-	template <typename ...A>
-	static bool forEach(A && ...args) {
-		return true;
-	}
+	enum { value = !! decltype(test<T>(0))() };
 };
 
 template <typename T, typename ...Args>
-struct HasFunctionMixinBeforeDispatch
+struct HasFunctionMixinAfterDispatch
 {
 	template <typename C> static std::true_type test(
-		decltype(std::declval<C>().mixinBeforeDispatch(std::declval<Args>()...)) *
+		decltype(std::declval<C>().mixinAfterDispatch(std::declval<Args>()...)) *
 	);
 	template <typename C> static std::false_type test(...);    
 
 	enum { value = !! decltype(test<T>(0))() };
 };
 
+// Invoke mixinBeforeDispatch of the mixins in the order of MixinList, then invoke func,
+// then invoke mixinAfterDispatch in the reverse order.
+// mixinAfterDispatch of a mixin is only invoked if its mixinBeforeDispatch, if any, has been invoked and returned true,
+// so a mixin can rely on the two functions being paired.
+// mixinAfterDispatch is invoked directly after the dispatching, so it can throw. If a listener or a hook after it throws,
+// it's invoked by a scope object during stack unwinding, then it must not throw, otherwise std::terminate is called.
+// A hook receives either the arguments, or the event followed by the arguments. If a hook accepts both,
+// the arguments only form is used.
+// mixinBeforeDispatchEvent always receives the event followed by the arguments, it's invoked after
+// mixinBeforeDispatch of the same mixin returns true, and is treated as a part of it.
+// The hooks are detected on T<Root>, not on the whole inheritance hierarchy, so a mixin which doesn't
+// define a hook doesn't invoke the hook inherited from the mixins after it.
+template <typename Root, typename TList>
+struct MixinDispatchChain;
+
+template <typename Root, template <typename> class T, template <typename> class ...Args>
+struct MixinDispatchChain <Root, MixinList<T, Args...> >
+{
+	using Type = typename InheritMixins<Root, MixinList<T, Args...> >::Type;
+	using OwnType = T<Root>;
+	using Next = MixinDispatchChain<Root, MixinList<Args...> >;
+
+	template <typename E, typename ...A>
+	struct HasAfterDispatch
+	{
+		enum {
+			value = HasFunctionMixinAfterDispatch<OwnType, A...>::value
+				|| HasFunctionMixinAfterDispatch<OwnType, const E &, A...>::value
+				|| Next::template HasAfterDispatch<E, A...>::value
+		};
+	};
+
+	template <typename Self, typename F, typename E, typename ...A>
+	static void invoke(const Self * self, F && func, const E & e, A & ...args) {
+		if(doBefore(self, e, args...) && doBeforeEvent(self, e, args...)) {
+			auto after = [self, &e, &args...]() {
+				doAfter(self, e, args...);
+			};
+			AfterDispatchGuard<decltype(after)> afterDispatchGuard(after);
+			Next::invoke(self, std::forward<F>(func), e, args...);
+			afterDispatchGuard.dismiss();
+			after();
+		}
+	}
+
+private:
+	// Only invokes func if the dispatching is left by an exception.
+	template <typename F>
+	struct AfterDispatchGuard
+	{
+		explicit AfterDispatchGuard(F & func) : func(func), dismissed(false) {
+		}
+
+		~AfterDispatchGuard() {
+			if(! dismissed) {
+				func();
+			}
+		}
+
+		void dismiss() {
+			dismissed = true;
+		}
+
+		F & func;
+		bool dismissed;
+	};
+
+	template <typename Self, typename E, typename ...A>
+	static auto doBefore(const Self * self, const E & /*e*/, A & ...args)
+		-> typename std::enable_if<HasFunctionMixinBeforeDispatch<OwnType, A &...>::value, bool>::type {
+		return static_cast<const Type *>(self)->mixinBeforeDispatch(args...);
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doBefore(const Self * self, const E & e, A & ...args)
+		-> typename std::enable_if<
+			! HasFunctionMixinBeforeDispatch<OwnType, A &...>::value
+				&& HasFunctionMixinBeforeDispatch<OwnType, const E &, A &...>::value,
+			bool
+		>::type {
+		return static_cast<const Type *>(self)->mixinBeforeDispatch(e, args...);
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doBefore(const Self * /*self*/, const E & /*e*/, A & .../*args*/)
+		-> typename std::enable_if<
+			! HasFunctionMixinBeforeDispatch<OwnType, A &...>::value
+				&& ! HasFunctionMixinBeforeDispatch<OwnType, const E &, A &...>::value,
+			bool
+		>::type {
+		return true;
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doBeforeEvent(const Self * self, const E & e, A & ...args)
+		-> typename std::enable_if<HasFunctionMixinBeforeDispatchEvent<OwnType, const E &, A &...>::value, bool>::type {
+		return static_cast<const Type *>(self)->mixinBeforeDispatchEvent(e, args...);
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doBeforeEvent(const Self * /*self*/, const E & /*e*/, A & .../*args*/)
+		-> typename std::enable_if<! HasFunctionMixinBeforeDispatchEvent<OwnType, const E &, A &...>::value, bool>::type {
+		return true;
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doAfter(const Self * self, const E & /*e*/, A & ...args)
+		-> typename std::enable_if<HasFunctionMixinAfterDispatch<OwnType, A &...>::value>::type {
+		static_cast<const Type *>(self)->mixinAfterDispatch(args...);
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doAfter(const Self * self, const E & e, A & ...args)
+		-> typename std::enable_if<
+			! HasFunctionMixinAfterDispatch<OwnType, A &...>::value
+				&& HasFunctionMixinAfterDispatch<OwnType, const E &, A &...>::value
+		>::type {
+		static_cast<const Type *>(self)->mixinAfterDispatch(e, args...);
+	}
+
+	template <typename Self, typename E, typename ...A>
+	static auto doAfter(const Self * /*self*/, const E & /*e*/, A & .../*args*/)
+		-> typename std::enable_if<
+			! HasFunctionMixinAfterDispatch<OwnType, A &...>::value
+				&& ! HasFunctionMixinAfterDispatch<OwnType, const E &, A &...>::value
+		>::type {
+	}
+};
+
+template <typename Root>
+struct MixinDispatchChain <Root, MixinList<> >
+{
+	template <typename E, typename ...A>
+	struct HasAfterDispatch
+	{
+		enum { value = false };
+	};
+
+	template <typename Self, typename F, typename E, typename ...A>
+	static void invoke(const Self * /*self*/, F && func, const E & /*e*/, A & .../*args*/) {
+		func();
+	}
+};
+
 
 } //namespace internal_
 
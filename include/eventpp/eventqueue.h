@@ -17,16 +17,366 @@
 #include "eventdispatcher.h"
 
 #include <list>
+#include <iterator>
+#include <type_traits>
 #include <tuple>
 #include <chrono>
 #include <mutex>
-#include <array>
+#include <atomic>
+#include <limits>
+#include <cstdint>
 #include <cassert>
 
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 namespace eventpp {
 
+/*
+A queue list holds the queued events for EventQueue, it's specified by the QueueList policy.
+A queue list must have below functions,
+
+	// Return true if there is no item. Can be called from any thread.
+	bool empty() const;
+
+	// Construct an item from args at the end of the list.
+	// Return false if the item is not queued.
+	template <typename ...A>
+	bool emplace(A && ...args);
+
+	// Same as emplace, but never blocks the caller. An unbounded list usually forwards to emplace.
+	template <typename ...A>
+	bool tryEmplace(A && ...args);
+
+	// Remove at most maxCount items from the front of the list, the items are only those
+	// in the list when consume is called. Invoke func(T &) on each item in order before the item is destroyed.
+	// Return the count of the removed items.
+	template <typename F>
+	std::size_t consume(F && func, const std::size_t maxCount);
+
+	// Copy the front item to *item. Return false if the list is empty.
+	bool peek(T * item) const;
+
+A queue list may have below optional function, EventQueue::enqueueBatch emplaces the items one by one if it's absent,
+
+	// Construct the items from the elements in the forward iterator range [first, last),
+	// and append them to the end of the list in one critical section.
+	// Return the count of queued items.
+	template <typename Iterator>
+	std::size_t emplaceRange(Iterator first, Iterator last);
+*/
+
 namespace internal_ {
 
+template <typename T>
+struct HasConstantMaxFreeItemCount
+{
+	template <typename C> static std::true_type test(decltype(C::maxFreeItemCount) *) ;
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+template <typename T, bool>
+struct SelectMaxFreeItemCount;
+template <typename T>
+struct SelectMaxFreeItemCount<T, true> {
+	static constexpr std::size_t value = T::maxFreeItemCount;
+};
+template <typename T>
+struct SelectMaxFreeItemCount<T, false> {
+	static constexpr std::size_t value = std::numeric_limits<std::size_t>::max();
+};
+
+} //namespace internal_
+
+// The default queue list. Both the queued items and the idle items are held in std::list,
+// and the nodes are moved between the lists by splicing, so the memory is reused.
+// At most the policy constant maxFreeItemCount idle items are kept, the default is unlimited.
+template <typename T, typename Policies>
+class ListQueueList
+{
+private:
+	using Threading = typename internal_::SelectThreading<Policies, internal_::HasTypeThreading<Policies>::value>::Type;
+	using Mutex = typename Threading::Mutex;
+
+	enum : std::size_t {
+		maxFreeItemCount = internal_::SelectMaxFreeItemCount<Policies, internal_::HasConstantMaxFreeItemCount<Policies>::value>::value
+	};
+
+	class Item
+	{
+	public:
+		Item() : buffer(), allocated(false)
+		{
+		}
+
+		~Item()
+		{
+			if(allocated) {
+				clear();
+			}
+		}
+
+		Item(Item &&) = delete;
+		Item(const Item &) = delete;
+		Item & operator = (const Item &) = delete;
+
+		template <typename ...A>
+		void set(A && ...args) {
+			assert(! allocated);
+
+			new (&buffer) T(std::forward<A>(args)...);
+			allocated = true;
+		}
+
+		T & get() {
+			assert(allocated);
+
+			return *reinterpret_cast<T *>(&buffer);
+		}
+
+		void clear() {
+			assert(allocated);
+
+			get().~T();
+			allocated = false;
+		}
+
+	private:
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type buffer;
+		bool allocated;
+	};
+
+public:
+	ListQueueList()
+		:
+			queueListMutex(),
+			queueList(),
+			freeListMutex(),
+			freeList(),
+			allocatedCount(0)
+	{
+	}
+
+	ListQueueList(ListQueueList &&) = delete;
+	ListQueueList(const ListQueueList &) = delete;
+	ListQueueList & operator = (const ListQueueList &) = delete;
+
+	bool empty() const {
+		return queueList.empty();
+	}
+
+	template <typename ...A>
+	bool emplace(A && ...args)
+	{
+		std::list<Item> tempList;
+		if(! freeList.empty()) {
+			{
+				std::lock_guard<Mutex> queueListLock(freeListMutex);
+				if(! freeList.empty()) {
+					tempList.splice(tempList.end(), freeList, freeList.begin());
+				}
+			}
+		}
+
+		if(tempList.empty()) {
+			tempList.emplace_back();
+			allocatedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		auto it = tempList.begin();
+		it->set(std::forward<A>(args)...);
+
+		std::lock_guard<Mutex> queueListLock(queueListMutex);
+		queueList.splice(queueList.end(), tempList, it);
+
+		return true;
+	}
+
+	template <typename ...A>
+	bool tryEmplace(A && ...args)
+	{
+		return emplace(std::forward<A>(args)...);
+	}
+
+	// The nodes are taken from the free list in one lock, and the items are linked to the queue in one lock.
+	template <typename Iterator>
+	std::size_t emplaceRange(Iterator first, Iterator last)
+	{
+		const std::size_t count = (std::size_t)std::distance(first, last);
+		if(count == 0) {
+			return 0;
+		}
+
+		std::list<Item> tempList;
+		if(! freeList.empty()) {
+			std::lock_guard<Mutex> queueListLock(freeListMutex);
+			if(count >= freeList.size()) {
+				tempList.splice(tempList.end(), freeList);
+			}
+			else {
+				auto end = freeList.begin();
+				std::advance(end, count);
+				tempList.splice(tempList.end(), freeList, freeList.begin(), end);
+			}
+		}
+		if(tempList.size() < count) {
+			allocatedCount.fetch_add(count - tempList.size(), std::memory_order_relaxed);
+			while(tempList.size() < count) {
+				tempList.emplace_back();
+			}
+		}
+
+		for(auto & item : tempList) {
+			item.set(*first);
+			++first;
+		}
+
+		std::lock_guard<Mutex> queueListLock(queueListMutex);
+		queueList.splice(queueList.end(), tempList);
+
+		return count;
+	}
+
+	template <typename F>
+	std::size_t consume(F && func, const std::size_t maxCount)
+	{
+		if(queueList.empty() || maxCount == 0) {
+			return 0;
+		}
+
+		std::list<Item> tempList;
+
+		{
+			std::lock_guard<Mutex> queueListLock(queueListMutex);
+
+			if(maxCount >= queueList.size()) {
+				using namespace std;
+				swap(queueList, tempList);
+			}
+			else {
+				auto end = queueList.begin();
+				std::advance(end, maxCount);
+				tempList.splice(tempList.end(), queueList, queueList.begin(), end);
+			}
+		}
+
+		std::size_t count = 0;
+		if(! tempList.empty()) {
+			for(auto & item : tempList) {
+				func(item.get());
+				item.clear();
+				++count;
+			}
+
+			doRecycle(tempList);
+		}
+
+		return count;
+	}
+
+	// Allocate the idle items so that there are at least count idle items, then enqueuing doesn't allocate memory
+	// until the idle items are used up. It's usually called at startup. count is limited by maxFreeItemCount.
+	void reserve(std::size_t count)
+	{
+		if(count > maxFreeItemCount) {
+			count = maxFreeItemCount;
+		}
+		const std::size_t freeCount = getFreeCount();
+		if(freeCount >= count) {
+			return;
+		}
+
+		std::list<Item> tempList(count - freeCount);
+		allocatedCount.fetch_add(tempList.size(), std::memory_order_relaxed);
+		doRecycle(tempList);
+	}
+
+	// Free all idle items, for example, after a spike of events.
+	void shrinkToFit()
+	{
+		std::list<Item> tempList;
+		{
+			std::lock_guard<Mutex> queueListLock(freeListMutex);
+			using namespace std;
+			swap(freeList, tempList);
+		}
+		allocatedCount.fetch_sub(tempList.size(), std::memory_order_relaxed);
+	}
+
+	std::size_t getQueuedCount() const {
+		std::lock_guard<Mutex> queueListLock(queueListMutex);
+		return queueList.size();
+	}
+
+	std::size_t getFreeCount() const {
+		std::lock_guard<Mutex> queueListLock(freeListMutex);
+		return freeList.size();
+	}
+
+	// The count of all items, including the queued, idle, and being dispatched items.
+	std::size_t getAllocatedCount() const {
+		return allocatedCount.load(std::memory_order_relaxed);
+	}
+
+	bool peek(T * item) const
+	{
+		if(! queueList.empty()) {
+			std::lock_guard<Mutex> queueListLock(queueListMutex);
+
+			if(! queueList.empty()) {
+				*item = const_cast<Item &>(queueList.front()).get();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	// Put the items back to the free list, the items above maxFreeItemCount are freed out of the lock.
+	void doRecycle(std::list<Item> & tempList)
+	{
+		{
+			std::lock_guard<Mutex> queueListLock(freeListMutex);
+			const std::size_t room = maxFreeItemCount - freeList.size();
+			if(room >= tempList.size()) {
+				freeList.splice(freeList.end(), tempList);
+				return;
+			}
+
+			auto end = tempList.begin();
+			std::advance(end, room);
+			freeList.splice(freeList.end(), tempList, tempList.begin(), end);
+		}
+		allocatedCount.fetch_sub(tempList.size(), std::memory_order_relaxed);
+		tempList.clear();
+	}
+
+private:
+	mutable Mutex queueListMutex;
+	std::list<Item> queueList;
+	mutable Mutex freeListMutex;
+	std::list<Item> freeList;
+	typename Threading::template Atomic<std::size_t> allocatedCount;
+};
+
+namespace internal_ {
+
+template <typename T, typename Iterator>
+struct HasFunctionEmplaceRange
+{
+	template <typename C> static std::true_type test(
+		decltype(std::declval<C &>().emplaceRange(std::declval<Iterator>(), std::declval<Iterator>())) *
+	);
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
 template <
 	typename EventType,
 	typename Prototype,
@@ -66,6 +416,7 @@ private:
 		>
 	>;
 
+protected:
 	using Policies = typename super::Policies;
 	using Event = typename super::Event;
 	using Mutex = typename super::Mutex;
@@ -78,51 +429,15 @@ private:
 		typename std::remove_cv<typename std::remove_reference<Args>::type>::type...
 	>;
 
-	class QueuedItem
-	{
-	public:
-		QueuedItem() : buffer(), allocated(false)
-		{
-		}
-
-		~QueuedItem()
-		{
-			if(allocated) {
-				clear();
-			}
-		}
-
-		QueuedItem(QueuedItem &&) = delete;
-		QueuedItem(const QueuedItem &) = delete;
-		QueuedItem & operator = (const QueuedItem &) = delete;
-
-		void set(QueuedEvent_ && item) {
-			assert(! allocated);
-
-			new (buffer.data()) QueuedEvent_(std::move(item));
-			allocated = true;
-		}
-
-		QueuedEvent_ & get() {
-			assert(allocated);
-
-			return *reinterpret_cast<QueuedEvent_ *>(buffer.data());
-		}
-
-		void clear() {
-			assert(allocated);
-
-			get().~QueuedEvent_();
-			allocated = false;
-		}
-
-	private:
-		std::array<char, sizeof(QueuedEvent_)> buffer;
-		bool allocated;
-	};
+	using QueueList_ = typename SelectQueueList<
+		QueuedEvent_,
+		Policies,
+		HasTemplateQueueList<Policies>::value
+	>::Type;
 
 public:
 	using QueuedEvent = QueuedEvent_;
+	using QueueList = QueueList_;
 
 	struct DisableQueueNotify
 	{
@@ -136,8 +451,8 @@ public:
 		{
 			--queue->queueNotifyCounter;
 
-			if(queue->doCanNotifyQueueAvailable() && ! queue->empty()) {
-				queue->queueListConditionVariable.notify_one();
+			if(! queue->empty()) {
+				queue->doNotifyQueueAvailable();
 			}
 		}
 
@@ -151,13 +466,25 @@ public:
 			queueListConditionVariable(),
 			queueEmptyCounter(0),
 			queueNotifyCounter(0),
+			queueWaiterCounter(0),
+			queueWakeUpCounter(0),
 			queueListMutex(),
 			queueList(),
-			freeListMutex(),
-			freeList()
+			readyFd(-1),
+			readySignaled(false)
 	{
 	}
 
+	~EventQueueBase()
+	{
+#if defined(__linux__)
+		const int fd = readyFd.load(std::memory_order_acquire);
+		if(fd >= 0) {
+			::close(fd);
+		}
+#endif
+	}
+
 	EventQueueBase(EventQueueBase &&) = delete;
 	EventQueueBase(const EventQueueBase &) = delete;
 	EventQueueBase & operator = (const EventQueueBase &) = delete;
@@ -167,14 +494,10 @@ public:
 	{
 		static_assert(super::ArgumentPassingMode::canIncludeEventType, "Enqueuing arguments count doesn't match required (Event type should be included).");
 
-		doEnqueue(QueuedEvent(
+		doEnqueue(
 			GetEvent::getEvent(args...),
 			std::forward<A>(args)...
-		));
-
-		if(doCanProcess()) {
-			queueListConditionVariable.notify_one();
-		}
+		);
 	}
 
 	template <typename T, typename ...A>
@@ -182,14 +505,84 @@ public:
 	{
 		static_assert(super::ArgumentPassingMode::canExcludeEventType, "Enqueuing arguments count doesn't match required (Event type should NOT be included).");
 
-		doEnqueue(QueuedEvent(
+		doEnqueue(
+			GetEvent::getEvent(std::forward<T>(first), args...),
+			std::forward<A>(args)...
+		);
+	}
+
+	// Same as enqueue, but the arguments are forwarded instead of being passed by value.
+	// Each queued argument is constructed in the queue list storage from the forwarded argument directly,
+	// there is no intermediate copy or move.
+	template <typename ...A>
+	auto emplace(A && ...args) -> typename std::enable_if<sizeof...(A) == sizeof...(Args), void>::type
+	{
+		static_assert(super::ArgumentPassingMode::canIncludeEventType, "Enqueuing arguments count doesn't match required (Event type should be included).");
+
+		doEnqueue(
+			GetEvent::getEvent(args...),
+			std::forward<A>(args)...
+		);
+	}
+
+	template <typename T, typename ...A>
+	auto emplace(T && first, A && ...args) -> typename std::enable_if<sizeof...(A) == sizeof...(Args), void>::type
+	{
+		static_assert(super::ArgumentPassingMode::canExcludeEventType, "Enqueuing arguments count doesn't match required (Event type should NOT be included).");
+
+		doEnqueue(
 			GetEvent::getEvent(std::forward<T>(first), args...),
 			std::forward<A>(args)...
-		));
+		);
+	}
+
+	// Return false if the queue list doesn't accept the event, for example, the queue list is bounded and full.
+	// Never blocks even if enqueue blocks.
+	template <typename ...A>
+	auto tryEnqueue(A ...args) -> typename std::enable_if<sizeof...(A) == sizeof...(Args), bool>::type
+	{
+		static_assert(super::ArgumentPassingMode::canIncludeEventType, "Enqueuing arguments count doesn't match required (Event type should be included).");
+
+		return doTryEnqueue(
+			GetEvent::getEvent(args...),
+			std::forward<A>(args)...
+		);
+	}
+
+	template <typename T, typename ...A>
+	auto tryEnqueue(T && first, A ...args) -> typename std::enable_if<sizeof...(A) == sizeof...(Args), bool>::type
+	{
+		static_assert(super::ArgumentPassingMode::canExcludeEventType, "Enqueuing arguments count doesn't match required (Event type should NOT be included).");
 
-		if(doCanProcess()) {
-			queueListConditionVariable.notify_one();
+		return doTryEnqueue(
+			GetEvent::getEvent(std::forward<T>(first), args...),
+			std::forward<A>(args)...
+		);
+	}
+
+	// Enqueue the QueuedEvent elements in the forward iterator range [first, last), such as the events decoded from
+	// a network packet. The events are linked to the queue in one critical section if the queue list supports it,
+	// and the waiting threads are notified once. Use std::make_move_iterator to move the events.
+	// Return the count of queued events.
+	template <typename Iterator>
+	std::size_t enqueueBatch(Iterator first, Iterator last)
+	{
+		const std::size_t count = doEmplaceRange(
+			first,
+			last,
+			std::integral_constant<bool, HasFunctionEmplaceRange<QueueList, Iterator>::value>()
+		);
+		if(count > 0) {
+			doNotifyQueueAvailable(count);
 		}
+
+		return count;
+	}
+
+	template <typename Range>
+	std::size_t enqueueBatch(Range && range)
+	{
+		return enqueueBatch(std::begin(range), std::end(range));
 	}
 
 	bool empty() const {
@@ -198,46 +591,95 @@ public:
 
 	void process()
 	{
-		if(! queueList.empty()) {
-			std::list<QueuedItem> tempList;
-
-			// Use a counter to tell the queue list is not empty during processing
-			// even though queueList is swapped to empty.
-			CounterGuard<decltype(queueEmptyCounter)> counterGuard(queueEmptyCounter);
+		doProcess(std::numeric_limits<std::size_t>::max());
+	}
 
-			{
-				std::lock_guard<Mutex> queueListLock(queueListMutex);
-				using namespace std;
-				swap(queueList, tempList);
+	// Return a file descriptor which becomes readable when the queue has events, so the queue can be
+	// polled by epoll, poll or select together with the sockets. It's an eventfd created on the first call,
+	// and it's owned by the queue. Return -1 if it's not supported (not Linux) or can't be created.
+	// Only one write is issued for each empty to non-empty transition, the descriptor is reset by processReady.
+	int getReadyFd()
+	{
+#if defined(__linux__)
+		int fd = readyFd.load(std::memory_order_acquire);
+		if(fd < 0) {
+			std::lock_guard<Mutex> queueListLock(queueListMutex);
+			fd = readyFd.load(std::memory_order_acquire);
+			if(fd < 0) {
+				fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+				if(fd < 0) {
+					return -1;
+				}
+				readyFd.store(fd, std::memory_order_release);
+				// The events enqueued before the descriptor exists didn't signal it.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if(! queueList.empty()) {
+					doSignalReadyFd(fd);
+				}
 			}
+		}
+		return fd;
+#else
+		return -1;
+#endif
+	}
 
-			if(! tempList.empty()) {
-				for(auto & item : tempList) {
-					doDispatchQueuedEvent(item.get(), typename internal_::MakeIndexSequence<sizeof...(Args) + 1>::Type());
-					item.clear();
-				}
+	// Reset the ready descriptor, then dispatch the events like process().
+	// The events enqueued during processing make the descriptor readable again.
+	// Call it instead of process() when the descriptor is readable, otherwise it stays readable.
+	// Return the count of dispatched events.
+	std::size_t processReady()
+	{
+		doResetReadyFd();
+		return doProcess(std::numeric_limits<std::size_t>::max());
+	}
 
-				std::lock_guard<Mutex> queueListLock(freeListMutex);
-				freeList.splice(freeList.end(), tempList);
+	// Dispatch one event, return false if the queue is empty.
+	bool processOne()
+	{
+		return doProcess(1) != 0;
+	}
+
+	// Dispatch at most count events in the order they are enqueued, the remaining events stay in the queue.
+	// Return the count of dispatched events.
+	std::size_t processCount(const std::size_t count)
+	{
+		return doProcess(count);
+	}
+
+	// Dispatch the events until the queue is empty or the time point is reached, the remaining events stay in the queue.
+	// The clock is checked every processClockInterval events, so it may run over the time point by that many events.
+	// Unlike process(), the events enqueued during processing are dispatched too.
+	// Return the count of dispatched events.
+	template <class Clock, class Duration>
+	std::size_t processUntil(const std::chrono::time_point<Clock, Duration> & timePoint)
+	{
+		std::size_t result = 0;
+		while(Clock::now() < timePoint) {
+			const std::size_t count = doProcess(processClockInterval);
+			result += count;
+			if(count < processClockInterval) {
+				break;
 			}
 		}
+		return result;
+	}
+
+	template <class Rep, class Period>
+	std::size_t processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		return processUntil(std::chrono::steady_clock::now() + duration);
 	}
 
 	void wait() const
 	{
-		std::unique_lock<Mutex> queueListLock(queueListMutex);
-		queueListConditionVariable.wait(queueListLock, [this]() -> bool {
-			return doCanProcess();
-		});
+		doWait(doGetWakeUpCounter());
 	}
 
 	template <class Rep, class Period>
 	bool waitFor(const std::chrono::duration<Rep, Period> & duration) const
 	{
-		std::unique_lock<Mutex> queueListLock(queueListMutex);
-		return queueListConditionVariable.wait_for(queueListLock, duration, [this]() -> bool {
-			return doCanProcess();
-		});
+		return doWaitFor(duration, doGetWakeUpCounter());
 	}
 
 	void dispatch(const QueuedEvent & queuedEvent)
@@ -252,52 +694,206 @@ public:
 
 	bool peekEvent(QueuedEvent * queuedEvent)
 	{
-		if(! queueList.empty()) {
-			std::lock_guard<Mutex> queueListLock(queueListMutex);
-			
-			if(! queueList.empty()) {
-				*queuedEvent = queueList.front().get();
-				return true;
-			}
+		return queueList.peek(queuedEvent);
+	}
+
+	bool takeEvent(QueuedEvent * queuedEvent)
+	{
+		return queueList.consume([queuedEvent](QueuedEvent & item) {
+			*queuedEvent = std::move(item);
+		}, 1) != 0;
+	}
+
+	// Access the underlying queue list, for the functions specific to the queue list type.
+	QueueList & getQueueList() {
+		return queueList;
+	}
+
+	const QueueList & getQueueList() const {
+		return queueList;
+	}
+
+protected:
+	enum : std::size_t {
+		processClockInterval = 16
+	};
+
+	// Dispatch at most maxCount events.
+	std::size_t doProcess(const std::size_t maxCount)
+	{
+		if(queueList.empty()) {
+			return 0;
 		}
 
-		return false;
+		// Use a counter to tell the queue list is not empty during processing
+		// even though the items are removed from queueList.
+		CounterGuard<decltype(queueEmptyCounter)> counterGuard(queueEmptyCounter);
+
+		return queueList.consume([this](QueuedEvent & item) {
+			doDispatchQueuedEvent(item, typename internal_::MakeIndexSequence<sizeof...(Args) + 1>::Type());
+		}, maxCount);
 	}
 
-	bool takeEvent(QueuedEvent * queuedEvent)
+	// While the guard is alive the queue is not empty, even though the events are removed from the queue list.
+	// It's used by the mixins which process the events out of process().
+	struct ProcessingGuard
 	{
-		if(! queueList.empty()) {
-			std::list<QueuedItem> tempList;
+		explicit ProcessingGuard(EventQueueBase * queue)
+			: counterGuard(queue->queueEmptyCounter)
+		{
+		}
 
-			{
-				std::lock_guard<Mutex> queueListLock(queueListMutex);
+		CounterGuard<typename Threading::template Atomic<int> > counterGuard;
+	};
 
-				if(! queueList.empty()) {
-					tempList.splice(tempList.end(), queueList, queueList.begin());
+	bool doCanProcess() const {
+		return ! empty() && doCanNotifyQueueAvailable();
+	}
+
+	bool doCanNotifyQueueAvailable() const {
+		return queueNotifyCounter.load(std::memory_order_acquire) == 0;
+	}
+
+	// Only lock the mutex and notify if there are waiting threads, and write the ready descriptor if it exists.
+	// The fence pairs with the increment of queueWaiterCounter in wait/waitFor,
+	// either the waiter sees the queued item, or the notifier sees the waiter.
+	// All waiting threads are woken up if more than one event is queued.
+	void doNotifyQueueAvailable(const std::size_t queuedCount = 1) const
+	{
+		if(doCanNotifyQueueAvailable()) {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			// The fence also pairs with the one in getReadyFd, either the event signals the new descriptor,
+			// or getReadyFd sees the event.
+			const int fd = readyFd.load(std::memory_order_acquire);
+			if(fd >= 0) {
+				doSignalReadyFd(fd);
+			}
+			if(queueWaiterCounter.load(std::memory_order_seq_cst) != 0) {
+				{
+					std::lock_guard<Mutex> queueListLock(queueListMutex);
+				}
+				if(queuedCount > 1) {
+					queueListConditionVariable.notify_all();
+				}
+				else {
+					queueListConditionVariable.notify_one();
 				}
 			}
+		}
+	}
 
-			if(! tempList.empty()) {
-				*queuedEvent = std::move(tempList.front().get());
-				tempList.front().clear();
+	// Write the ready descriptor only if it's not written since the last reset, so there is
+	// at most one system call for each empty to non-empty transition.
+	void doSignalReadyFd(const int fd) const
+	{
+#if defined(__linux__)
+		if(! readySignaled.exchange(true, std::memory_order_acq_rel)) {
+			const uint64_t value = 1;
+			const ssize_t result = ::write(fd, &value, sizeof(value));
+			(void)result;
+		}
+#else
+		(void)fd;
+#endif
+	}
 
-				std::lock_guard<Mutex> queueListLock(freeListMutex);
-				freeList.splice(freeList.end(), tempList);
+	// Called by the consumer before processing. The descriptor is drained before the flag is cleared,
+	// so a write after the flag is cleared is never lost. The exchange pairs with the one in doSignalReadyFd,
+	// the events which didn't write because the flag was set are visible to the processing.
+	void doResetReadyFd()
+	{
+#if defined(__linux__)
+		const int fd = readyFd.load(std::memory_order_acquire);
+		if(fd >= 0 && readySignaled.load(std::memory_order_acquire)) {
+			uint64_t value;
+			const ssize_t result = ::read(fd, &value, sizeof(value));
+			(void)result;
+			readySignaled.exchange(false, std::memory_order_acq_rel);
+		}
+#endif
+	}
 
-				return true;
+	// Wake up all threads blocked in wait and waitFor even if the queue is empty.
+	// It's used by the mixins which need the waiting threads to check their own states.
+	// The counter is increased even if there is no waiting thread, so a thread which is about to wait
+	// with an older counter from doGetWakeUpCounter doesn't block.
+	void doWakeUpWaiters() const
+	{
+		queueWakeUpCounter.fetch_add(1, std::memory_order_seq_cst);
+		if(queueWaiterCounter.load(std::memory_order_seq_cst) != 0) {
+			{
+				std::lock_guard<Mutex> queueListLock(queueListMutex);
 			}
+			queueListConditionVariable.notify_all();
 		}
+	}
 
-		return false;
+	// The mixins which wait on their own states read the counter before checking the states,
+	// then pass it to doWait or doWaitFor, so a doWakeUpWaiters after the check is not missed.
+	unsigned int doGetWakeUpCounter() const {
+		return queueWakeUpCounter.load(std::memory_order_seq_cst);
 	}
 
-private:
-	bool doCanProcess() const {
-		return ! empty() && doCanNotifyQueueAvailable();
+	// Wait until the queue can be processed, or doWakeUpWaiters is called after wakeUpCounter is read.
+	void doWait(const unsigned int wakeUpCounter) const
+	{
+		std::unique_lock<Mutex> queueListLock(queueListMutex);
+		CounterGuard<decltype(queueWaiterCounter)> waiterGuard(queueWaiterCounter);
+		queueListConditionVariable.wait(queueListLock, [this, wakeUpCounter]() -> bool {
+			return doCanProcess() || queueWakeUpCounter.load(std::memory_order_seq_cst) != wakeUpCounter;
+		});
 	}
 
-	bool doCanNotifyQueueAvailable() const {
-		return queueNotifyCounter.load(std::memory_order_acquire) == 0;
+	template <class Rep, class Period>
+	bool doWaitFor(const std::chrono::duration<Rep, Period> & duration, const unsigned int wakeUpCounter) const
+	{
+		std::unique_lock<Mutex> queueListLock(queueListMutex);
+		CounterGuard<decltype(queueWaiterCounter)> waiterGuard(queueWaiterCounter);
+		queueListConditionVariable.wait_for(queueListLock, duration, [this, wakeUpCounter]() -> bool {
+			return doCanProcess() || queueWakeUpCounter.load(std::memory_order_seq_cst) != wakeUpCounter;
+		});
+		return doCanProcess();
+	}
+
+	// Same arguments as enqueue, used by the mixins to store the events for later enqueuing.
+	template <typename ...A>
+	auto doMakeQueuedEvent(A && ...args) const
+		-> typename std::enable_if<sizeof...(A) == sizeof...(Args), QueuedEvent>::type
+	{
+		static_assert(super::ArgumentPassingMode::canIncludeEventType, "Enqueuing arguments count doesn't match required (Event type should be included).");
+
+		return QueuedEvent(GetEvent::getEvent(args...), std::forward<A>(args)...);
+	}
+
+	template <typename T, typename ...A>
+	auto doMakeQueuedEvent(T && first, A && ...args) const
+		-> typename std::enable_if<sizeof...(A) == sizeof...(Args), QueuedEvent>::type
+	{
+		static_assert(super::ArgumentPassingMode::canExcludeEventType, "Enqueuing arguments count doesn't match required (Event type should NOT be included).");
+
+		return QueuedEvent(GetEvent::getEvent(std::forward<T>(first), args...), std::forward<A>(args)...);
+	}
+
+	bool doEnqueueQueuedEvent(QueuedEvent && queuedEvent)
+	{
+		return doEnqueueQueuedEvent(std::move(queuedEvent), typename internal_::MakeIndexSequence<sizeof...(Args) + 1>::Type());
+	}
+
+	template <size_t ...Indexes>
+	bool doEnqueueQueuedEvent(QueuedEvent && queuedEvent, internal_::IndexSequence<Indexes...>)
+	{
+		return doEnqueue(std::get<Indexes>(std::move(queuedEvent))...);
+	}
+
+	bool doTryEnqueueQueuedEvent(QueuedEvent && queuedEvent)
+	{
+		return doTryEnqueueQueuedEvent(std::move(queuedEvent), typename internal_::MakeIndexSequence<sizeof...(Args) + 1>::Type());
+	}
+
+	template <size_t ...Indexes>
+	bool doTryEnqueueQueuedEvent(QueuedEvent && queuedEvent, internal_::IndexSequence<Indexes...>)
+	{
+		return doTryEnqueue(std::get<Indexes>(std::move(queuedEvent))...);
 	}
 
 	template <typename T, size_t ...Indexes>
@@ -306,37 +902,64 @@ private:
 		this->doDispatch(std::get<Indexes>(std::forward<T>(item))...);
 	}
 
-	void doEnqueue(QueuedEvent && item)
+	template <typename ...A>
+	bool doEnqueue(A && ...args)
 	{
-		std::list<QueuedItem> tempList;
-		if(! freeList.empty()) {
-			{
-				std::lock_guard<Mutex> queueListLock(freeListMutex);
-				if(! freeList.empty()) {
-					tempList.splice(tempList.end(), freeList, freeList.begin());
-				}
-			}
+		if(queueList.emplace(std::forward<A>(args)...)) {
+			doNotifyQueueAvailable();
+			return true;
 		}
 
-		if(tempList.empty()) {
-			tempList.emplace_back();
+		return false;
+	}
+
+	template <typename Iterator>
+	std::size_t doEmplaceRange(Iterator first, Iterator last, std::true_type)
+	{
+		return queueList.emplaceRange(first, last);
+	}
+
+	template <typename Iterator>
+	std::size_t doEmplaceRange(Iterator first, Iterator last, std::false_type)
+	{
+		std::size_t count = 0;
+		for(; first != last; ++first) {
+			if(doEmplaceQueuedEvent(*first, typename internal_::MakeIndexSequence<sizeof...(Args) + 1>::Type())) {
+				++count;
+			}
 		}
+		return count;
+	}
 
-		auto it = tempList.begin();
-		it->set(std::move(item));
+	// The queue lists may inspect the arguments, such as getPriority, so the queued event is expanded.
+	template <typename T, size_t ...Indexes>
+	bool doEmplaceQueuedEvent(T && item, internal_::IndexSequence<Indexes...>)
+	{
+		return queueList.emplace(std::get<Indexes>(std::forward<T>(item))...);
+	}
 
-		std::lock_guard<Mutex> queueListLock(queueListMutex);
-		queueList.splice(queueList.end(), tempList, it);
+	template <typename ...A>
+	bool doTryEnqueue(A && ...args)
+	{
+		if(queueList.tryEmplace(std::forward<A>(args)...)) {
+			doNotifyQueueAvailable();
+			return true;
+		}
+
+		return false;
 	}
 
 private:
 	mutable ConditionVariable queueListConditionVariable;
 	typename Threading::template Atomic<int> queueEmptyCounter;
 	typename Threading::template Atomic<int> queueNotifyCounter;
+	mutable typename Threading::template Atomic<int> queueWaiterCounter;
+	mutable typename Threading::template Atomic<unsigned int> queueWakeUpCounter;
 	mutable Mutex queueListMutex;
-	std::list<QueuedItem> queueList;
-	Mutex freeListMutex;
-	std::list<QueuedItem> freeList;
+	QueueList queueList;
+	// The eventfd returned by getReadyFd, -1 if it's not created.
+	typename Threading::template Atomic<int> readyFd;
+	mutable typename Threading::template Atomic<bool> readySignaled;
 };
 
 } //namespace internal_
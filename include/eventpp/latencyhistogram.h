@@ -0,0 +1,204 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LATENCYHISTOGRAM_H_602153940257
+#define LATENCYHISTOGRAM_H_602153940257
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace eventpp {
+
+// A lock free histogram with log-linear buckets (similar to HdrHistogram).
+// Values below 2^SubBucketBits are recorded exactly, larger values are recorded
+// with a relative error less than 1 / 2^SubBucketBits.
+// record() can be called from any threads simultaneously.
+template <int SubBucketBits = 5>
+class LatencyHistogram
+{
+private:
+	static_assert(SubBucketBits > 0 && SubBucketBits < 16, "SubBucketBits must be in range [1, 15].");
+
+	enum : uint64_t {
+		subBucketCount = uint64_t(1) << SubBucketBits,
+		bucketCount = (65 - SubBucketBits) * subBucketCount
+	};
+
+public:
+	using Value = uint64_t;
+
+public:
+	LatencyHistogram()
+		:
+			buckets(),
+			totalCount(0),
+			totalSum(0),
+			minValue(std::numeric_limits<Value>::max()),
+			maxValue(0)
+	{
+		for(auto & bucket : buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	LatencyHistogram(LatencyHistogram &&) = delete;
+	LatencyHistogram(const LatencyHistogram &) = delete;
+	LatencyHistogram & operator = (const LatencyHistogram &) = delete;
+
+	void record(const Value value)
+	{
+		buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		totalCount.fetch_add(1, std::memory_order_relaxed);
+		totalSum.fetch_add(value, std::memory_order_relaxed);
+
+		Value current = minValue.load(std::memory_order_relaxed);
+		while(value < current && ! minValue.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+		}
+		current = maxValue.load(std::memory_order_relaxed);
+		while(value > current && ! maxValue.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+		}
+	}
+
+	// Not atomic with regard to concurrent record().
+	void reset()
+	{
+		for(auto & bucket : buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		totalCount.store(0, std::memory_order_relaxed);
+		totalSum.store(0, std::memory_order_relaxed);
+		minValue.store(std::numeric_limits<Value>::max(), std::memory_order_relaxed);
+		maxValue.store(0, std::memory_order_relaxed);
+	}
+
+	uint64_t getCount() const {
+		return totalCount.load(std::memory_order_relaxed);
+	}
+
+	Value getMin() const {
+		return getCount() == 0 ? 0 : minValue.load(std::memory_order_relaxed);
+	}
+
+	Value getMax() const {
+		return maxValue.load(std::memory_order_relaxed);
+	}
+
+	double getMean() const {
+		const uint64_t count = getCount();
+		return count == 0 ? 0.0 : (double)totalSum.load(std::memory_order_relaxed) / (double)count;
+	}
+
+	// percentile is in range [0, 100].
+	// Return the highest value that is equivalent to the bucket the percentile falls in,
+	// clamped to the recorded maximum.
+	Value getValueAtPercentile(const double percentile) const
+	{
+		uint64_t count = 0;
+		for(const auto & bucket : buckets) {
+			count += bucket.load(std::memory_order_relaxed);
+		}
+		if(count == 0) {
+			return 0;
+		}
+
+		uint64_t target = (uint64_t)(percentile / 100.0 * (double)count + 0.5);
+		if(target < 1) {
+			target = 1;
+		}
+		if(target > count) {
+			target = count;
+		}
+
+		uint64_t accumulated = 0;
+		for(uint64_t i = 0; i < bucketCount; ++i) {
+			accumulated += buckets[i].load(std::memory_order_relaxed);
+			if(accumulated >= target) {
+				const Value value = getBucketHighestValue(i);
+				const Value max = getMax();
+				return value < max ? value : max;
+			}
+		}
+
+		return getMax();
+	}
+
+	// Apply func(lowestValue, highestValue, count) to all non-empty buckets.
+	template <typename Func>
+	void forEach(Func && func) const
+	{
+		for(uint64_t i = 0; i < bucketCount; ++i) {
+			const uint64_t count = buckets[i].load(std::memory_order_relaxed);
+			if(count != 0) {
+				func(getBucketLowestValue(i), getBucketHighestValue(i), count);
+			}
+		}
+	}
+
+private:
+	static int getHighestBit(Value value)
+	{
+		int result = 0;
+		for(int shift = 32; shift > 0; shift >>= 1) {
+			if(value >> shift) {
+				value >>= shift;
+				result += shift;
+			}
+		}
+		return result;
+	}
+
+	static uint64_t getBucketIndex(const Value value)
+	{
+		if(value < subBucketCount) {
+			return value;
+		}
+
+		const int shift = getHighestBit(value) - SubBucketBits;
+		return (uint64_t)shift * subBucketCount + (value >> shift);
+	}
+
+	static Value getBucketLowestValue(const uint64_t index)
+	{
+		if(index < subBucketCount) {
+			return index;
+		}
+
+		const uint64_t shift = index / subBucketCount - 1;
+		return (index - shift * subBucketCount) << shift;
+	}
+
+	static Value getBucketHighestValue(const uint64_t index)
+	{
+		if(index < subBucketCount) {
+			return index;
+		}
+
+		const uint64_t shift = index / subBucketCount - 1;
+		return getBucketLowestValue(index) + ((Value(1) << shift) - 1);
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, bucketCount> buckets;
+	std::atomic<uint64_t> totalCount;
+	std::atomic<uint64_t> totalSum;
+	std::atomic<Value> minValue;
+	std::atomic<Value> maxValue;
+};
+
+
+} //namespace eventpp
+
+
+#endif
@@ -0,0 +1,77 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINDISPATCHTIMER_H_418526035913
+#define MIXINDISPATCHTIMER_H_418526035913
+
+#include "../latencyhistogram.h"
+
+#include <chrono>
+#include <vector>
+
+namespace eventpp {
+
+template <typename Base>
+class MixinDispatchTimer : public Base
+{
+private:
+	using super = Base;
+
+	using Clock = std::chrono::steady_clock;
+
+public:
+	using DispatchTimeHistogram = LatencyHistogram<>;
+
+public:
+	// The histogram of the time spent in each dispatching, in nanoseconds.
+	const DispatchTimeHistogram & getDispatchTimeHistogram() const {
+		return dispatchTimeHistogram;
+	}
+
+	void resetDispatchTimeHistogram() {
+		dispatchTimeHistogram.reset();
+	}
+
+	template <typename ...Args>
+	bool mixinBeforeDispatch(Args && ...) const {
+		getStartTimeStack().push_back(Clock::now());
+		return true;
+	}
+
+	template <typename ...Args>
+	void mixinAfterDispatch(Args && ...) const {
+		const Clock::time_point now = Clock::now();
+		std::vector<Clock::time_point> & startTimeStack = getStartTimeStack();
+		dispatchTimeHistogram.record(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTimeStack.back()).count()
+		);
+		startTimeStack.pop_back();
+	}
+
+private:
+	// mixinBeforeDispatch and mixinAfterDispatch are always paired and nested in the same thread,
+	// even if a listener throws, so one stack per thread is enough for nested dispatching and for all dispatchers.
+	static std::vector<Clock::time_point> & getStartTimeStack() {
+		static thread_local std::vector<Clock::time_point> startTimeStack;
+		return startTimeStack;
+	}
+
+private:
+	mutable DispatchTimeHistogram dispatchTimeHistogram;
+};
+
+
+} //namespace eventpp
+
+
+#endif
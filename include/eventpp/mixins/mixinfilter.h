@@ -19,6 +19,9 @@
 
 #include <functional>
 #include <type_traits>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace eventpp {
 
@@ -39,10 +42,59 @@ private:
 	using Filter = std::function<BoolReferencePrototype>;
 	using FilterList = CallbackList<BoolReferencePrototype>;
 
+	using Event = typename super::Event;
+	using Mutex = typename super::Mutex;
+
+	// Event filters are held by shared pointer, so a snapshot of the map keeps the filter lists alive
+	// after they are erased from the map.
+	using FilterListPtr = std::shared_ptr<FilterList>;
+	using EventFilterMap = typename internal_::SelectMap<
+		Event,
+		FilterListPtr,
+		typename super::Policies,
+		internal_::HasTemplateMap<typename super::Policies>::value
+	>::Type;
+
+	// Keep the snapshots retired while dispatching, they are deleted when no dispatching is reading them.
+	struct ReadingGuard
+	{
+		explicit ReadingGuard(const MixinFilter * mixin) : mixin(mixin) {
+			mixin->readingCount.fetch_add(1);
+		}
+
+		~ReadingGuard() {
+			if(mixin->readingCount.fetch_sub(1) == 1 && mixin->hasRetiredSnapshot.load(std::memory_order_acquire)) {
+				std::lock_guard<Mutex> lockGuard(mixin->eventFilterMutex);
+				mixin->doDeleteRetiredSnapshots();
+			}
+		}
+
+		const MixinFilter * mixin;
+	};
+
 public:
 	using FilterHandle = typename FilterList::Handle;
 
 public:
+	MixinFilter()
+		:
+			super(),
+			filterList(),
+			eventFilterMap(),
+			eventFilterSnapshot(nullptr),
+			retiredSnapshotList(),
+			eventFilterMutex(),
+			eventFilterCount(0),
+			readingCount(0),
+			hasRetiredSnapshot(false)
+	{
+	}
+
+	~MixinFilter()
+	{
+		delete eventFilterSnapshot.load(std::memory_order_acquire);
+	}
+
 	FilterHandle appendFilter(const Filter & filter)
 	{
 		return filterList.append(filter);
@@ -53,8 +105,66 @@ public:
 		return filterList.remove(filterHandle);
 	}
 
+	FilterHandle appendFilter(const Event & event, const Filter & filter)
+	{
+		std::lock_guard<Mutex> lockGuard(eventFilterMutex);
+
+		FilterListPtr & eventFilterList = eventFilterMap[event];
+		if(! eventFilterList) {
+			eventFilterList = std::make_shared<FilterList>();
+			doPublishSnapshot();
+		}
+		eventFilterCount.fetch_add(1, std::memory_order_release);
+		return eventFilterList->append(filter);
+	}
+
+	bool removeFilter(const Event & event, const FilterHandle & filterHandle)
+	{
+		std::lock_guard<Mutex> lockGuard(eventFilterMutex);
+
+		auto it = eventFilterMap.find(event);
+		if(it == eventFilterMap.end() || ! it->second->remove(filterHandle)) {
+			return false;
+		}
+
+		eventFilterCount.fetch_sub(1, std::memory_order_release);
+		if(it->second->empty()) {
+			eventFilterMap.erase(it);
+			doPublishSnapshot();
+		}
+		return true;
+	}
+
 	template <typename ...Args>
 	bool mixinBeforeDispatch(Args && ...args) const {
+		return doInvokeFilterList(filterList, args...);
+	}
+
+	// Invoked after mixinBeforeDispatch, so the global filters are invoked first, then the filters of the event.
+	// The filters of the event are looked up in an immutable snapshot of the map, without locking,
+	// and nothing is looked up while no event filter exists.
+	template <typename ...Args>
+	bool mixinBeforeDispatchEvent(const Event & e, Args & ...args) const
+	{
+		if(eventFilterCount.load(std::memory_order_acquire) == 0) {
+			return true;
+		}
+
+		ReadingGuard readingGuard(this);
+		const EventFilterMap * snapshot = eventFilterSnapshot.load();
+		if(snapshot != nullptr) {
+			auto it = snapshot->find(e);
+			if(it != snapshot->end()) {
+				return doInvokeFilterList(*it->second, args...);
+			}
+		}
+
+		return true;
+	}
+
+private:
+	template <typename ...Args>
+	static bool doInvokeFilterList(const FilterList & filterList, Args & ...args) {
 		if(! filterList.empty()) {
 			if(
 				! filterList.forEachIf([&args...](typename FilterList::Callback & callback) {
@@ -68,8 +178,39 @@ public:
 		return true;
 	}
 
+	// eventFilterMutex must be locked by the caller.
+	// The snapshot being replaced may be read by dispatching, so it's retired and deleted later.
+	void doPublishSnapshot()
+	{
+		const EventFilterMap * snapshot = eventFilterMap.empty() ? nullptr : new EventFilterMap(eventFilterMap);
+		const EventFilterMap * oldSnapshot = eventFilterSnapshot.exchange(snapshot);
+		if(oldSnapshot != nullptr) {
+			retiredSnapshotList.emplace_back(oldSnapshot);
+			hasRetiredSnapshot.store(true, std::memory_order_release);
+		}
+		doDeleteRetiredSnapshots();
+	}
+
+	// eventFilterMutex must be locked by the caller.
+	// A dispatching which begins after the snapshots are retired can't see them,
+	// so they can be deleted once no dispatching is reading.
+	void doDeleteRetiredSnapshots() const
+	{
+		if(! retiredSnapshotList.empty() && readingCount.load() == 0) {
+			retiredSnapshotList.clear();
+			hasRetiredSnapshot.store(false, std::memory_order_release);
+		}
+	}
+
 private:
 	FilterList filterList;
+	EventFilterMap eventFilterMap;
+	typename super::Threading::template Atomic<const EventFilterMap *> eventFilterSnapshot;
+	mutable std::vector<std::unique_ptr<const EventFilterMap> > retiredSnapshotList;
+	mutable Mutex eventFilterMutex;
+	typename super::Threading::template Atomic<int> eventFilterCount;
+	mutable typename super::Threading::template Atomic<int> readingCount;
+	mutable typename super::Threading::template Atomic<bool> hasRetiredSnapshot;
 };
 
 
@@ -0,0 +1,823 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINJOURNAL_H_527390184613
+#define MIXINJOURNAL_H_527390184613
+
+#include "../eventpolicies.h"
+#include "../eventdispatcher.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <tuple>
+#include <iterator>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+// The journal requires POSIX mmap.
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+namespace eventpp {
+
+enum class JournalSync
+{
+	// Never call msync, the journal survives the process crash but not the system crash.
+	none,
+	// Schedule the write back with msync(MS_ASYNC).
+	async,
+	// Wait for the write back with msync(MS_SYNC).
+	sync
+};
+
+namespace internal_ {
+
+// A log split into segment files named pathPrefix.0000000000, pathPrefix.0000000001, etc.
+// Each segment is mapped to memory, appending an entry is a memcpy, there is no system call
+// unless a new segment is created or the segment is synchronized.
+// Segment layout: SegmentHeader, then the entries, each entry is EntryHeader followed by the payload,
+// aligned to 8 bytes. The rest of the segment is zero.
+// A segment records the sequence of the last consumed entry when the segment is written,
+// the recovery uses the greatest one among the segments.
+// The class is not thread safe.
+class MappedJournal
+{
+private:
+	enum : uint64_t {
+		segmentMagic = 0x4c4e524a50505645ull // "EVPPJRNL"
+	};
+
+	enum : std::size_t {
+		segmentHeaderSize = 64,
+		entryAlignment = 8,
+		segmentIndexDigits = 10
+	};
+
+	struct SegmentHeader
+	{
+		uint64_t magic;
+		uint64_t firstSequence;
+		uint64_t consumedSequence;
+	};
+
+	struct EntryHeader
+	{
+		uint32_t payloadSize;
+		uint32_t checksum;
+		uint64_t sequence;
+	};
+
+	struct Segment
+	{
+		uint64_t index;
+		int fd;
+		char * data;
+		std::size_t size;
+		uint64_t firstSequence;
+		uint64_t lastSequence;
+		// The end of the last valid entry.
+		std::size_t endOffset;
+	};
+
+public:
+	MappedJournal()
+		:
+			pathPrefix(),
+			segmentSize(0),
+			segmentList(),
+			nextSequence(1),
+			consumedSequence(0),
+			lastEntryOffset(0),
+			syncedOffset(0),
+			syncMode(JournalSync::none),
+			opened(false)
+	{
+	}
+
+	~MappedJournal()
+	{
+		close();
+	}
+
+	MappedJournal(const MappedJournal &) = delete;
+	MappedJournal & operator = (const MappedJournal &) = delete;
+
+	// Open the existing segments and create a new segment for appending.
+	// Return false if the segments can't be opened or created.
+	bool open(const std::string & pathPrefix_, const std::size_t segmentSize_)
+	{
+		close();
+
+		pathPrefix = pathPrefix_;
+		segmentSize = (std::max)(segmentSize_, (std::size_t)(segmentHeaderSize + sizeof(EntryHeader) + entryAlignment));
+		segmentSize = (segmentSize + entryAlignment - 1) / entryAlignment * entryAlignment;
+		nextSequence = 1;
+		consumedSequence = 0;
+
+		std::vector<uint64_t> indexList;
+		if(! doListSegmentIndexes(&indexList)) {
+			return false;
+		}
+
+		for(const uint64_t index : indexList) {
+			Segment segment;
+			if(doMapSegment(index, 0, &segment)) {
+				doScanSegment(&segment);
+				segmentList.push_back(segment);
+			}
+		}
+
+		uint64_t nextIndex = 0;
+		for(const Segment & segment : segmentList) {
+			nextIndex = segment.index + 1;
+			nextSequence = (std::max)(nextSequence, segment.lastSequence + 1);
+			consumedSequence = (std::max)(
+				consumedSequence,
+				reinterpret_cast<const SegmentHeader *>(segment.data)->consumedSequence
+			);
+		}
+
+		opened = doCreateSegment(nextIndex);
+		if(! opened) {
+			close();
+		}
+		return opened;
+	}
+
+	// The appended entries are written back with the sync mode before the segments are unmapped.
+	void close()
+	{
+		if(opened) {
+			sync(syncMode);
+		}
+		for(Segment & segment : segmentList) {
+			doUnmapSegment(segment);
+		}
+		segmentList.clear();
+		opened = false;
+	}
+
+	bool isOpened() const {
+		return opened;
+	}
+
+	// The mode used when a segment is full and a new segment is created, and when the journal is closed.
+	void setSyncMode(const JournalSync mode) {
+		syncMode = mode;
+	}
+
+	// Invoke func(uint64_t sequence, const char * data, std::size_t size) on each entry which is not consumed,
+	// in the order they are appended. It stops at the first missing sequence, such as a torn entry in a segment
+	// which is followed by other segments, the entries after the gap can't be recovered in order.
+	template <typename F>
+	std::size_t forEachUnconsumed(F && func) const
+	{
+		std::size_t count = 0;
+		uint64_t expectedSequence = consumedSequence + 1;
+		for(const Segment & segment : segmentList) {
+			std::size_t offset = segmentHeaderSize;
+			while(offset < segment.endOffset) {
+				const EntryHeader * header = reinterpret_cast<const EntryHeader *>(segment.data + offset);
+				if(header->sequence >= expectedSequence) {
+					if(header->sequence != expectedSequence) {
+						return count;
+					}
+					func(header->sequence, segment.data + offset + sizeof(EntryHeader), (std::size_t)header->payloadSize);
+					++expectedSequence;
+					++count;
+				}
+				offset += doGetEntrySize(header->payloadSize);
+			}
+		}
+		return count;
+	}
+
+	// Return the sequence of the entry, or 0 if the entry can't be appended.
+	uint64_t append(const char * payload, const std::size_t payloadSize)
+	{
+		const std::size_t entrySize = doGetEntrySize(payloadSize);
+		if(! opened
+			|| payloadSize > (std::numeric_limits<uint32_t>::max)()
+			|| entrySize > segmentSize - segmentHeaderSize) {
+			return 0;
+		}
+
+		if(segmentList.back().endOffset + entrySize > segmentList.back().size) {
+			// The entries in the full segment which are not synchronized yet won't be synchronized by
+			// the later sync calls, which only write back the current segment.
+			sync(syncMode);
+			if(! doCreateSegment(segmentList.back().index + 1)) {
+				return 0;
+			}
+		}
+
+		Segment & segment = segmentList.back();
+		const uint64_t sequence = nextSequence;
+		char * entry = segment.data + segment.endOffset;
+		std::memcpy(entry + sizeof(EntryHeader), payload, payloadSize);
+		EntryHeader * header = reinterpret_cast<EntryHeader *>(entry);
+		header->sequence = sequence;
+		header->checksum = doCalculateChecksum(sequence, payload, payloadSize);
+		// A torn entry has wrong sequence or checksum.
+		header->payloadSize = (uint32_t)payloadSize;
+
+		lastEntryOffset = segment.endOffset;
+		segment.endOffset += entrySize;
+		segment.lastSequence = sequence;
+		++nextSequence;
+
+		return sequence;
+	}
+
+	// Remove the entry appended by the last append, it's used when the event is not queued.
+	void cancelLast()
+	{
+		Segment & segment = segmentList.back();
+		if(segment.lastSequence + 1 != nextSequence || segment.lastSequence < segment.firstSequence) {
+			return;
+		}
+		std::memset(segment.data + lastEntryOffset, 0, segment.endOffset - lastEntryOffset);
+		segment.endOffset = lastEntryOffset;
+		--segment.lastSequence;
+		--nextSequence;
+	}
+
+	// Record that all entries up to sequence are consumed, and remove the segments which are entirely consumed.
+	void markConsumed(const uint64_t sequence, const JournalSync syncMode)
+	{
+		if(! opened || sequence <= consumedSequence) {
+			return;
+		}
+		consumedSequence = sequence;
+
+		Segment & current = segmentList.back();
+		reinterpret_cast<SegmentHeader *>(current.data)->consumedSequence = consumedSequence;
+		if(syncMode != JournalSync::none) {
+			::msync(current.data, segmentHeaderSize, syncMode == JournalSync::sync ? MS_SYNC : MS_ASYNC);
+		}
+
+		while(segmentList.size() > 1 && segmentList.front().lastSequence <= consumedSequence) {
+			doUnmapSegment(segmentList.front());
+			::unlink(doGetSegmentPath(segmentList.front().index).c_str());
+			segmentList.erase(segmentList.begin());
+		}
+	}
+
+	// Write back the entries appended since the last sync.
+	void sync(const JournalSync syncMode)
+	{
+		if(! opened || syncMode == JournalSync::none) {
+			return;
+		}
+
+		const Segment & segment = segmentList.back();
+		if(syncedOffset < segment.endOffset) {
+			const std::size_t pageSize = (std::size_t)::sysconf(_SC_PAGESIZE);
+			const std::size_t begin = syncedOffset / pageSize * pageSize;
+			::msync(segment.data + begin, segment.endOffset - begin, syncMode == JournalSync::sync ? MS_SYNC : MS_ASYNC);
+			syncedOffset = segment.endOffset;
+		}
+	}
+
+	uint64_t getConsumedSequence() const {
+		return consumedSequence;
+	}
+
+	std::size_t getSegmentCount() const {
+		return segmentList.size();
+	}
+
+private:
+	static std::size_t doGetEntrySize(const std::size_t payloadSize) {
+		return (sizeof(EntryHeader) + payloadSize + entryAlignment - 1) / entryAlignment * entryAlignment;
+	}
+
+	// FNV-1a
+	static uint32_t doCalculateChecksum(const uint64_t sequence, const char * payload, const std::size_t payloadSize)
+	{
+		uint32_t hash = 2166136261u;
+		for(int i = 0; i < 8; ++i) {
+			hash = (hash ^ (uint32_t)((sequence >> (i * 8)) & 0xff)) * 16777619u;
+		}
+		for(std::size_t i = 0; i < payloadSize; ++i) {
+			hash = (hash ^ (uint32_t)(unsigned char)payload[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	std::string doGetSegmentPath(const uint64_t index) const
+	{
+		std::string text = std::to_string(index);
+		if(text.size() < segmentIndexDigits) {
+			text.insert(0, segmentIndexDigits - text.size(), '0');
+		}
+		return pathPrefix + "." + text;
+	}
+
+	bool doListSegmentIndexes(std::vector<uint64_t> * indexList) const
+	{
+		const std::string::size_type slash = pathPrefix.rfind('/');
+		const std::string directory = (slash == std::string::npos ? std::string(".") : pathPrefix.substr(0, slash + 1));
+		const std::string namePrefix = (slash == std::string::npos ? pathPrefix : pathPrefix.substr(slash + 1)) + ".";
+
+		DIR * dir = ::opendir(directory.c_str());
+		if(dir == nullptr) {
+			return false;
+		}
+		while(const dirent * item = ::readdir(dir)) {
+			const std::string name(item->d_name);
+			if(name.size() == namePrefix.size() + segmentIndexDigits
+				&& name.compare(0, namePrefix.size(), namePrefix) == 0
+				&& name.find_first_not_of("0123456789", namePrefix.size()) == std::string::npos) {
+				indexList->push_back(std::strtoull(name.c_str() + namePrefix.size(), nullptr, 10));
+			}
+		}
+		::closedir(dir);
+
+		std::sort(indexList->begin(), indexList->end());
+		return true;
+	}
+
+	// If size is 0, the existing file is mapped with its own size.
+	bool doMapSegment(const uint64_t index, const std::size_t size, Segment * segment) const
+	{
+		const std::string path = doGetSegmentPath(index);
+		const int fd = ::open(path.c_str(), size == 0 ? O_RDWR : (O_RDWR | O_CREAT | O_EXCL), 0644);
+		if(fd < 0) {
+			return false;
+		}
+
+		std::size_t mapSize = size;
+		if(size == 0) {
+			struct stat fileStat;
+			if(::fstat(fd, &fileStat) != 0 || (std::size_t)fileStat.st_size < segmentHeaderSize) {
+				::close(fd);
+				return false;
+			}
+			mapSize = (std::size_t)fileStat.st_size;
+		}
+		else if(::ftruncate(fd, (off_t)size) != 0) {
+			::close(fd);
+			::unlink(path.c_str());
+			return false;
+		}
+
+		void * data = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(data == MAP_FAILED) {
+			::close(fd);
+			if(size != 0) {
+				::unlink(path.c_str());
+			}
+			return false;
+		}
+
+		segment->index = index;
+		segment->fd = fd;
+		segment->data = static_cast<char *>(data);
+		segment->size = mapSize;
+		segment->firstSequence = 0;
+		segment->lastSequence = 0;
+		segment->endOffset = segmentHeaderSize;
+
+		if(size == 0 && reinterpret_cast<const SegmentHeader *>(segment->data)->magic != segmentMagic) {
+			doUnmapSegment(*segment);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Find the valid entries, the scan stops at the first torn or missing entry.
+	static void doScanSegment(Segment * segment)
+	{
+		segment->firstSequence = reinterpret_cast<const SegmentHeader *>(segment->data)->firstSequence;
+		uint64_t expectedSequence = segment->firstSequence;
+		std::size_t offset = segmentHeaderSize;
+		while(offset + sizeof(EntryHeader) <= segment->size) {
+			const EntryHeader * header = reinterpret_cast<const EntryHeader *>(segment->data + offset);
+			const std::size_t entrySize = doGetEntrySize(header->payloadSize);
+			// The zero filled space has sequence 0, which is never valid.
+			if(entrySize > segment->size - offset
+				|| header->sequence != expectedSequence
+				|| header->checksum != doCalculateChecksum(
+					header->sequence, segment->data + offset + sizeof(EntryHeader), header->payloadSize)
+				) {
+				break;
+			}
+			offset += entrySize;
+			++expectedSequence;
+		}
+		segment->endOffset = offset;
+		segment->lastSequence = expectedSequence - 1;
+	}
+
+	bool doCreateSegment(const uint64_t index)
+	{
+		Segment segment;
+		if(! doMapSegment(index, segmentSize, &segment)) {
+			return false;
+		}
+
+		SegmentHeader * header = reinterpret_cast<SegmentHeader *>(segment.data);
+		header->magic = segmentMagic;
+		header->firstSequence = nextSequence;
+		header->consumedSequence = consumedSequence;
+		segment.firstSequence = nextSequence;
+		segment.lastSequence = nextSequence - 1;
+
+		segmentList.push_back(segment);
+		syncedOffset = 0;
+		return true;
+	}
+
+	static void doUnmapSegment(const Segment & segment)
+	{
+		::munmap(segment.data, segment.size);
+		::close(segment.fd);
+	}
+
+private:
+	std::string pathPrefix;
+	std::size_t segmentSize;
+	// Sorted by index, the last one is used for appending.
+	std::vector<Segment> segmentList;
+	uint64_t nextSequence;
+	uint64_t consumedSequence;
+	std::size_t lastEntryOffset;
+	std::size_t syncedOffset;
+	JournalSync syncMode;
+	bool opened;
+};
+
+} //namespace internal_
+
+// Only for EventQueue. Records each enqueued event to a memory mapped write-ahead journal before the event is queued,
+// and marks the events consumed after they are dispatched by any process function or taken by takeEvent.
+// After a crash, recoverJournal re-enqueues the events which are not consumed.
+// The journal sequences are kept in the order the events are queued, and the dispatched events are matched
+// by count, so the queue list must dispatch the events in the order they are queued, and there must be one consumer.
+// The policies must have the functions,
+//	static void serializeEvent(std::string & data, const Event & e, const Args & ...args);
+//	static bool deserializeEvent(const char * data, std::size_t size, Event & e, Args & ...args);
+// serializeEvent appends the bytes to data. deserializeEvent returns false if the data is invalid.
+// The queued event types must be default constructible.
+template <typename Base>
+class MixinJournal : public Base
+{
+private:
+	using super = Base;
+
+	using Mutex = typename super::Mutex;
+	using Threading = typename super::Threading;
+	using Policies = typename super::Policies;
+
+public:
+	using QueuedEvent = typename super::QueuedEvent;
+
+public:
+	MixinJournal()
+		:
+			super(),
+			journal(),
+			journalMutex(),
+			journalOpened(false),
+			queuedSequenceList(),
+			journalErrorCount(0),
+			syncMode(JournalSync::none),
+			syncInterval(1),
+			unsyncedCount(0),
+			serializeBuffer()
+	{
+	}
+
+	// Open the journal segments pathPrefix.0000000000, pathPrefix.0000000001, etc, they are created if they don't exist.
+	// New segments of segmentSize bytes are created when the current segment is full.
+	// Call recoverJournal before enqueuing to dispatch the events which were not consumed.
+	// Return false if the journal can't be opened.
+	bool openJournal(const std::string & pathPrefix, const std::size_t segmentSize = 64 * 1024 * 1024)
+	{
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		journal.setSyncMode(syncMode);
+		const bool result = journal.open(pathPrefix, segmentSize);
+		journalOpened.store(result, std::memory_order_release);
+		return result;
+	}
+
+	void closeJournal()
+	{
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		journal.close();
+		journalOpened.store(false, std::memory_order_release);
+		queuedSequenceList.clear();
+	}
+
+	// Re-enqueue the events in the journal which were not consumed. The events are not journaled again.
+	// The recovery stops at the first missing entry. Return the count of re-enqueued events.
+	std::size_t recoverJournal()
+	{
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+
+		std::size_t count = 0;
+		journal.forEachUnconsumed([this, &count](const uint64_t sequence, const char * data, const std::size_t size) {
+			QueuedEvent queuedEvent;
+			if(doDeserialize(data, size, queuedEvent, typename internal_::MakeIndexSequence<std::tuple_size<QueuedEvent>::value>::Type())) {
+				if(super::doEnqueueQueuedEvent(std::move(queuedEvent))) {
+					queuedSequenceList.push_back(sequence);
+					++count;
+				}
+			}
+			else {
+				journalErrorCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+
+		return count;
+	}
+
+	// Call msync with mode after each interval appended events. The default mode is JournalSync::none.
+	void setJournalSync(const JournalSync mode, const std::size_t interval = 1)
+	{
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		syncMode = mode;
+		syncInterval = (interval > 0 ? interval : 1);
+		journal.setSyncMode(mode);
+	}
+
+	// Write back the journaled events with msync(MS_SYNC).
+	void syncJournal()
+	{
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		journal.sync(JournalSync::sync);
+		unsyncedCount = 0;
+	}
+
+	// The count of the events which can't be journaled or recovered.
+	std::size_t getJournalErrorCount() const {
+		return journalErrorCount.load(std::memory_order_relaxed);
+	}
+
+	// The events are still queued if they can't be journaled, and the error count is increased.
+	template <typename ...A>
+	void enqueue(A && ...args)
+	{
+		doJournalEnqueue(this->doMakeQueuedEvent(std::forward<A>(args)...), false);
+	}
+
+	template <typename ...A>
+	void emplace(A && ...args)
+	{
+		doJournalEnqueue(this->doMakeQueuedEvent(std::forward<A>(args)...), false);
+	}
+
+	// Return false and don't queue the event if it can't be journaled.
+	template <typename ...A>
+	bool tryEnqueue(A && ...args)
+	{
+		return doJournalEnqueue(this->doMakeQueuedEvent(std::forward<A>(args)...), true);
+	}
+
+	template <typename Iterator>
+	std::size_t enqueueBatch(Iterator first, Iterator last)
+	{
+		if(! journalOpened.load(std::memory_order_acquire)) {
+			return super::enqueueBatch(first, last);
+		}
+
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		std::vector<uint64_t> sequenceList;
+		for(Iterator it = first; it != last; ++it) {
+			const QueuedEvent & queuedEvent = *it;
+			sequenceList.push_back(doAppend(queuedEvent));
+		}
+		// If the queue list doesn't accept all events, the accepted ones are the front of the batch.
+		const std::size_t count = super::enqueueBatch(first, last);
+		queuedSequenceList.insert(queuedSequenceList.end(), sequenceList.begin(), sequenceList.begin() + count);
+		return count;
+	}
+
+	template <typename Range>
+	std::size_t enqueueBatch(Range && range)
+	{
+		return enqueueBatch(std::begin(range), std::end(range));
+	}
+
+	// The dispatched events are marked consumed after each process function returns.
+	void process()
+	{
+		doMarkDispatched(super::processCount(std::numeric_limits<std::size_t>::max()));
+	}
+
+	std::size_t processReady()
+	{
+		return doMarkDispatched(super::processReady());
+	}
+
+	bool processOne()
+	{
+		return doMarkDispatched(super::processOne() ? 1 : 0) != 0;
+	}
+
+	std::size_t processCount(const std::size_t count)
+	{
+		return doMarkDispatched(super::processCount(count));
+	}
+
+	template <class C, class Duration>
+	std::size_t processUntil(const std::chrono::time_point<C, Duration> & timePoint)
+	{
+		return doMarkDispatched(super::processUntil(timePoint));
+	}
+
+	template <class Rep, class Period>
+	std::size_t processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		return doMarkDispatched(super::processFor(duration));
+	}
+
+	// The taken event is marked consumed, the caller is responsible for it.
+	bool takeEvent(QueuedEvent * queuedEvent)
+	{
+		return doMarkDispatched(super::takeEvent(queuedEvent) ? 1 : 0) != 0;
+	}
+
+	// Only available if a mixin under this one, such as MixinParallelProcess, has processParallel.
+	// They dispatch the events queued when they are called, the events queued during dispatching
+	// are marked consumed when the queue becomes empty.
+	template <typename B = super, typename ...A>
+	auto processParallel(A && ...args)
+		-> decltype(std::declval<B &>().processParallel(std::forward<A>(args)...))
+	{
+		const std::size_t count = doGetQueuedSequenceCount();
+		B::processParallel(std::forward<A>(args)...);
+		doMarkDispatched(count);
+	}
+
+	template <typename B = super, typename ...A>
+	auto processPartitioned(A && ...args)
+		-> decltype(std::declval<B &>().processPartitioned(std::forward<A>(args)...))
+	{
+		const std::size_t count = doGetQueuedSequenceCount();
+		B::processPartitioned(std::forward<A>(args)...);
+		doMarkDispatched(count);
+	}
+
+protected:
+	// The events queued by the mixins above this one, such as MixinTimedQueue, are not journaled,
+	// but they are tracked so the journaled events after them are matched correctly.
+	bool doEnqueueQueuedEvent(QueuedEvent && queuedEvent)
+	{
+		if(! journalOpened.load(std::memory_order_acquire)) {
+			return super::doEnqueueQueuedEvent(std::move(queuedEvent));
+		}
+
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		const bool queued = super::doEnqueueQueuedEvent(std::move(queuedEvent));
+		if(queued) {
+			queuedSequenceList.push_back(0);
+		}
+		return queued;
+	}
+
+	bool doTryEnqueueQueuedEvent(QueuedEvent && queuedEvent)
+	{
+		if(! journalOpened.load(std::memory_order_acquire)) {
+			return super::doTryEnqueueQueuedEvent(std::move(queuedEvent));
+		}
+
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		const bool queued = super::doTryEnqueueQueuedEvent(std::move(queuedEvent));
+		if(queued) {
+			queuedSequenceList.push_back(0);
+		}
+		return queued;
+	}
+
+private:
+	// The journal mutex is held while the event is queued, so the events are journaled in the order they are queued,
+	// and queuedSequenceList is in the same order as the queue.
+	bool doJournalEnqueue(QueuedEvent && queuedEvent, const bool tryOnly)
+	{
+		if(! journalOpened.load(std::memory_order_acquire)) {
+			return tryOnly ? super::doTryEnqueueQueuedEvent(std::move(queuedEvent)) : super::doEnqueueQueuedEvent(std::move(queuedEvent));
+		}
+
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		const uint64_t sequence = doAppend(queuedEvent);
+		if(sequence == 0 && tryOnly) {
+			return false;
+		}
+
+		const bool queued = tryOnly ? super::doTryEnqueueQueuedEvent(std::move(queuedEvent)) : super::doEnqueueQueuedEvent(std::move(queuedEvent));
+		if(queued) {
+			queuedSequenceList.push_back(sequence);
+		}
+		else if(sequence != 0) {
+			journal.cancelLast();
+		}
+		return queued;
+	}
+
+	// Must be called with journalMutex locked.
+	uint64_t doAppend(const QueuedEvent & queuedEvent)
+	{
+		serializeBuffer.clear();
+		doSerialize(queuedEvent, typename internal_::MakeIndexSequence<std::tuple_size<QueuedEvent>::value>::Type());
+		const uint64_t sequence = journal.append(serializeBuffer.data(), serializeBuffer.size());
+		if(sequence == 0) {
+			journalErrorCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if(syncMode != JournalSync::none && ++unsyncedCount >= syncInterval) {
+			journal.sync(syncMode);
+			unsyncedCount = 0;
+		}
+		return sequence;
+	}
+
+	std::size_t doGetQueuedSequenceCount()
+	{
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		return queuedSequenceList.size();
+	}
+
+	// count events are dispatched from the front of the queue, mark the journaled ones consumed.
+	// If the queue is empty, all tracked events are dispatched, it also recovers from the events
+	// which are dispatched but not counted, such as the ones queued during processParallel.
+	std::size_t doMarkDispatched(const std::size_t count)
+	{
+		if(! journalOpened.load(std::memory_order_acquire)) {
+			return count;
+		}
+
+		std::lock_guard<Mutex> lockGuard(journalMutex);
+		std::size_t remaining = this->getQueueList().empty() ? queuedSequenceList.size() : count;
+		uint64_t sequence = 0;
+		while(remaining > 0 && ! queuedSequenceList.empty()) {
+			if(queuedSequenceList.front() != 0) {
+				sequence = queuedSequenceList.front();
+			}
+			queuedSequenceList.pop_front();
+			--remaining;
+		}
+		if(sequence != 0) {
+			journal.markConsumed(sequence, syncMode);
+		}
+		return count;
+	}
+
+	template <size_t ...Indexes>
+	void doSerialize(const QueuedEvent & queuedEvent, internal_::IndexSequence<Indexes...>)
+	{
+		static_assert(internal_::HasFunctionSerializeEvent<Policies, typename std::tuple_element<Indexes, QueuedEvent>::type...>::value,
+			"MixinJournal requires the policy function serializeEvent.");
+		Policies::serializeEvent(serializeBuffer, std::get<Indexes>(queuedEvent)...);
+	}
+
+	template <size_t ...Indexes>
+	static bool doDeserialize(const char * data, const std::size_t size, QueuedEvent & queuedEvent, internal_::IndexSequence<Indexes...>)
+	{
+		static_assert(internal_::HasFunctionDeserializeEvent<Policies, typename std::tuple_element<Indexes, QueuedEvent>::type...>::value,
+			"MixinJournal requires the policy function deserializeEvent.");
+		return Policies::deserializeEvent(data, size, std::get<Indexes>(queuedEvent)...);
+	}
+
+private:
+	internal_::MappedJournal journal;
+	Mutex journalMutex;
+	typename Threading::template Atomic<bool> journalOpened;
+	// The journal sequences of the queued events in the queue order, 0 for the events which are not journaled.
+	std::deque<uint64_t> queuedSequenceList;
+	typename Threading::template Atomic<std::size_t> journalErrorCount;
+	JournalSync syncMode;
+	std::size_t syncInterval;
+	std::size_t unsyncedCount;
+	std::string serializeBuffer;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
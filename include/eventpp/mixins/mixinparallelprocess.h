@@ -0,0 +1,469 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINPARALLELPROCESS_H_572048316935
+#define MIXINPARALLELPROCESS_H_572048316935
+
+#include "../eventpolicies.h"
+#include "../eventdispatcher.h"
+
+#include <vector>
+#include <thread>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// The policy functions are detected by calling them with the actual argument types,
+// so template and overloaded functions are detected too.
+template <typename T, typename Event>
+struct HasFunctionIsOrderInsensitive
+{
+	template <typename C> static std::true_type test(
+		decltype(C::isOrderInsensitive(std::declval<const Event &>())) *
+	);
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+template <typename Policies, bool>
+struct SelectIsOrderInsensitive;
+
+template <typename Policies>
+struct SelectIsOrderInsensitive <Policies, true>
+{
+	template <typename E>
+	static bool isOrderInsensitive(const E & e) {
+		return Policies::isOrderInsensitive(e);
+	}
+};
+
+// Calling processParallel declares all events are order insensitive.
+template <typename Policies>
+struct SelectIsOrderInsensitive <Policies, false>
+{
+	template <typename E>
+	static bool isOrderInsensitive(const E & /*e*/) {
+		return true;
+	}
+};
+
+template <typename T, typename QueuedEvent>
+struct HasFunctionGetPartitionKey;
+
+template <typename T, typename Event, typename ...Args>
+struct HasFunctionGetPartitionKey <T, std::tuple<Event, Args...> >
+{
+	template <typename C> static std::true_type test(
+		typename std::remove_reference<
+			decltype(C::getPartitionKey(std::declval<const Event &>(), std::declval<const Args &>()...))
+		>::type *
+	);
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+template <typename Policies, typename QueuedEvent, bool>
+struct SelectPartitionKey;
+
+template <typename Policies, typename Event, typename ...Args>
+struct SelectPartitionKey <Policies, std::tuple<Event, Args...>, true>
+{
+	using Type = typename std::decay<
+		decltype(Policies::getPartitionKey(std::declval<const Event &>(), std::declval<const Args &>()...))
+	>::type;
+
+	template <typename ...A>
+	static Type getPartitionKey(const A & ...args) {
+		return Policies::getPartitionKey(args...);
+	}
+};
+
+// By default the key is the event type.
+template <typename Policies, typename Event, typename ...Args>
+struct SelectPartitionKey <Policies, std::tuple<Event, Args...>, false>
+{
+	using Type = Event;
+
+	template <typename ...A>
+	static Type getPartitionKey(const Event & e, const A & ...) {
+		return e;
+	}
+};
+
+// Runs func(index) for each index in [0, count) on workerCount workers.
+// Each worker owns a contiguous range of the indexes and takes them in batches from the front,
+// a worker which runs out of its range steals the back half of the remaining range of another worker.
+// The workers always run on multiple threads, so it uses std::mutex even if the Threading policy is SingleThreading.
+class WorkStealingRunner
+{
+private:
+	using Mutex = std::mutex;
+	using ConditionVariable = std::condition_variable;
+
+	struct Range
+	{
+		Range() : mutex(), begin(0), end(0)
+		{
+		}
+
+		Mutex mutex;
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	enum : std::size_t {
+		maxBatchSize = 64
+	};
+
+public:
+	WorkStealingRunner(const std::size_t count, const std::size_t workerCount)
+		:
+			rangeList(workerCount),
+			batchSize(count / (workerCount * 8)),
+			finishedCount(0),
+			finishedMutex(),
+			finishedConditionVariable()
+	{
+		if(batchSize == 0) {
+			batchSize = 1;
+		}
+		else if(batchSize > maxBatchSize) {
+			batchSize = maxBatchSize;
+		}
+
+		for(std::size_t i = 0; i < workerCount; ++i) {
+			rangeList[i].begin = count * i / workerCount;
+			rangeList[i].end = count * (i + 1) / workerCount;
+		}
+	}
+
+	WorkStealingRunner(WorkStealingRunner &&) = delete;
+	WorkStealingRunner(const WorkStealingRunner &) = delete;
+	WorkStealingRunner & operator = (const WorkStealingRunner &) = delete;
+
+	template <typename F>
+	void run(const std::size_t workerIndex, F & func)
+	{
+		std::size_t begin;
+		std::size_t end;
+		while(doTake(workerIndex, &begin, &end) || doSteal(workerIndex, &begin, &end)) {
+			for(; begin < end; ++begin) {
+				func(begin);
+			}
+		}
+	}
+
+	// Call finish when a worker except the calling thread exits, even if func throws,
+	// otherwise waitFinished never returns.
+	struct FinishGuard
+	{
+		explicit FinishGuard(WorkStealingRunner & runner) : runner(runner)
+		{
+		}
+
+		~FinishGuard()
+		{
+			runner.finish();
+		}
+
+		WorkStealingRunner & runner;
+	};
+
+	// Wait for the started workers when the calling thread leaves doRunParallel, even if it throws,
+	// because the workers still use the runner and func.
+	struct WaitGuard
+	{
+		explicit WaitGuard(WorkStealingRunner & runner) : runner(runner), startedCount(0)
+		{
+		}
+
+		~WaitGuard()
+		{
+			runner.waitFinished(startedCount);
+		}
+
+		WorkStealingRunner & runner;
+		std::size_t startedCount;
+	};
+
+	// Called by each worker except the calling thread when it finishes.
+	// Notify under the lock, otherwise the runner may be destroyed before notify_one returns.
+	void finish()
+	{
+		std::lock_guard<Mutex> lockGuard(finishedMutex);
+		++finishedCount;
+		finishedConditionVariable.notify_one();
+	}
+
+	void waitFinished(const std::size_t count)
+	{
+		std::unique_lock<Mutex> lock(finishedMutex);
+		finishedConditionVariable.wait(lock, [this, count]() -> bool {
+			return finishedCount == count;
+		});
+	}
+
+private:
+	bool doTake(const std::size_t workerIndex, std::size_t * begin, std::size_t * end)
+	{
+		Range & range = rangeList[workerIndex];
+
+		std::lock_guard<Mutex> lockGuard(range.mutex);
+		if(range.begin == range.end) {
+			return false;
+		}
+		*begin = range.begin;
+		*end = range.end - range.begin > batchSize ? range.begin + batchSize : range.end;
+		range.begin = *end;
+		return true;
+	}
+
+	// The stolen indexes become the range of the thief, so they can be stolen again.
+	bool doSteal(const std::size_t workerIndex, std::size_t * begin, std::size_t * end)
+	{
+		const std::size_t workerCount = rangeList.size();
+		for(std::size_t i = 1; i < workerCount; ++i) {
+			Range & victim = rangeList[(workerIndex + i) % workerCount];
+			std::size_t stolenBegin;
+			std::size_t stolenEnd;
+			{
+				std::lock_guard<Mutex> lockGuard(victim.mutex);
+				const std::size_t remaining = victim.end - victim.begin;
+				if(remaining == 0) {
+					continue;
+				}
+				stolenEnd = victim.end;
+				stolenBegin = victim.end - (remaining + 1) / 2;
+				victim.end = stolenBegin;
+			}
+
+			{
+				Range & range = rangeList[workerIndex];
+				std::lock_guard<Mutex> lockGuard(range.mutex);
+				range.begin = stolenBegin;
+				range.end = stolenEnd;
+			}
+
+			return doTake(workerIndex, begin, end);
+		}
+
+		return false;
+	}
+
+private:
+	std::vector<Range> rangeList;
+	std::size_t batchSize;
+	std::size_t finishedCount;
+	Mutex finishedMutex;
+	ConditionVariable finishedConditionVariable;
+};
+
+// The threads created by processParallel and processPartitioned, they are joined even if processing throws.
+struct ThreadJoinGuard
+{
+	~ThreadJoinGuard()
+	{
+		for(auto & thread : threadList) {
+			thread.join();
+		}
+	}
+
+	std::vector<std::thread> threadList;
+};
+
+} //namespace internal_
+
+// Only for EventQueue. Adds processParallel and processPartitioned which dispatch the queued events on multiple threads.
+// The listeners must be thread safe. processParallel dispatches the events in no particular order,
+// except the events for which the policy function isOrderInsensitive(const Event &) returns false.
+// processPartitioned dispatches the events with the same key, returned by the policy function getPartitionKey,
+// in the order they are enqueued.
+template <typename Base>
+class MixinParallelProcess : public Base
+{
+private:
+	using super = Base;
+
+protected:
+	// Not private, so the mixins above this one, such as MixinStagedEnqueue, can still use the types of the queue.
+	using Policies = typename super::Policies;
+	using Threading = typename super::Threading;
+	using QueuedEvent = typename super::QueuedEvent;
+
+private:
+	using SelectIsOrderInsensitive = internal_::SelectIsOrderInsensitive<
+		Policies, internal_::HasFunctionIsOrderInsensitive<Policies, typename super::Event>::value
+	>;
+	using SelectPartitionKey = internal_::SelectPartitionKey<
+		Policies, QueuedEvent, internal_::HasFunctionGetPartitionKey<Policies, QueuedEvent>::value
+	>;
+
+	// More partitions than workers, so the workers can balance the load by stealing partitions.
+	enum : std::size_t {
+		partitionsPerWorker = 8
+	};
+
+public:
+	using PartitionKey = typename SelectPartitionKey::Type;
+
+public:
+	// Dispatch the events which are queued when it's called on workerCount workers, the calling thread is one of them.
+	// executor(task) must run the task on another thread, such as posting it to a thread pool,
+	// it's called workerCount - 1 times at most. processParallel returns after all tasks finish.
+	// The order sensitive events are dispatched in the calling thread in the order they are enqueued.
+	template <typename Executor>
+	void processParallel(const std::size_t workerCount, Executor && executor)
+	{
+		if(this->getQueueList().empty()) {
+			return;
+		}
+
+		typename super::ProcessingGuard processingGuard(this);
+
+		std::vector<QueuedEvent> orderedList;
+		std::vector<QueuedEvent> parallelList;
+		this->getQueueList().consume([&orderedList, &parallelList](QueuedEvent & item) {
+			if(SelectIsOrderInsensitive::isOrderInsensitive(std::get<0>(item))) {
+				parallelList.push_back(std::move(item));
+			}
+			else {
+				orderedList.push_back(std::move(item));
+			}
+		}, std::numeric_limits<std::size_t>::max());
+
+		auto func = [this, &parallelList](const std::size_t index) {
+			this->dispatch(std::move(parallelList[index]));
+		};
+		doRunParallel(parallelList.size(), workerCount, executor, func, [this, &orderedList]() {
+			for(auto & item : orderedList) {
+				this->dispatch(std::move(item));
+			}
+		});
+	}
+
+	// Same as above, but the workers run on the threads created for this call.
+	void processParallel(const std::size_t workerCount)
+	{
+		internal_::ThreadJoinGuard threadJoinGuard;
+		processParallel(workerCount, [&threadJoinGuard](std::function<void ()> task) {
+			threadJoinGuard.threadList.emplace_back(std::move(task));
+		});
+	}
+
+	// Dispatch the events which are queued when it's called on workerCount workers, the calling thread is one of them.
+	// The events are hashed by their keys to workerCount * 8 partitions. A partition is dispatched by one worker
+	// in the order the events are enqueued, so the events with the same key are dispatched in order,
+	// and the events with different keys may be dispatched concurrently. The idle workers steal the partitions.
+	// executor is the same as processParallel.
+	template <typename Executor>
+	void processPartitioned(std::size_t workerCount, Executor && executor)
+	{
+		if(this->getQueueList().empty()) {
+			return;
+		}
+
+		typename super::ProcessingGuard processingGuard(this);
+
+		if(workerCount == 0) {
+			workerCount = 1;
+		}
+		std::vector<std::vector<QueuedEvent> > partitionList(workerCount * partitionsPerWorker);
+		this->getQueueList().consume([&partitionList](QueuedEvent & item) {
+			partitionList[doGetPartitionIndex(item, partitionList.size())].push_back(std::move(item));
+		}, std::numeric_limits<std::size_t>::max());
+
+		partitionList.erase(
+			std::remove_if(partitionList.begin(), partitionList.end(), [](const std::vector<QueuedEvent> & partition) {
+				return partition.empty();
+			}),
+			partitionList.end()
+		);
+
+		auto func = [this, &partitionList](const std::size_t index) {
+			for(auto & item : partitionList[index]) {
+				this->dispatch(std::move(item));
+			}
+		};
+		doRunParallel(partitionList.size(), workerCount, executor, func, []() {});
+	}
+
+	// Same as above, but the workers run on the threads created for this call.
+	void processPartitioned(const std::size_t workerCount)
+	{
+		internal_::ThreadJoinGuard threadJoinGuard;
+		processPartitioned(workerCount, [&threadJoinGuard](std::function<void ()> task) {
+			threadJoinGuard.threadList.emplace_back(std::move(task));
+		});
+	}
+
+private:
+	// Run func(index) for each index in [0, count) on the workers, callingThreadFunc is invoked in the calling thread
+	// after the other workers are started. Return after all started workers finish, even if it throws.
+	// If executor throws, the task is assumed not started.
+	template <typename Executor, typename F, typename C>
+	void doRunParallel(const std::size_t count, std::size_t workerCount, Executor & executor, F & func, C && callingThreadFunc)
+	{
+		if(workerCount > count) {
+			workerCount = count;
+		}
+		if(workerCount == 0) {
+			workerCount = 1;
+		}
+
+		internal_::WorkStealingRunner runner(count, workerCount);
+		internal_::WorkStealingRunner::WaitGuard waitGuard(runner);
+
+		for(std::size_t i = 1; i < workerCount; ++i) {
+			executor([&runner, &func, i]() {
+				internal_::WorkStealingRunner::FinishGuard finishGuard(runner);
+				runner.run(i, func);
+			});
+			++waitGuard.startedCount;
+		}
+
+		callingThreadFunc();
+		runner.run(0, func);
+	}
+
+	static std::size_t doGetPartitionIndex(const QueuedEvent & item, const std::size_t partitionCount)
+	{
+		return std::hash<PartitionKey>()(
+			doGetPartitionKey(item, typename internal_::MakeIndexSequence<std::tuple_size<QueuedEvent>::value>::Type())
+		) % partitionCount;
+	}
+
+	template <size_t ...Indexes>
+	static PartitionKey doGetPartitionKey(const QueuedEvent & item, internal_::IndexSequence<Indexes...>)
+	{
+		return SelectPartitionKey::getPartitionKey(std::get<Indexes>(item)...);
+	}
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
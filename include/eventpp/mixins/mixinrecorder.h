@@ -0,0 +1,326 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINRECORDER_H_906152748301
+#define MIXINRECORDER_H_906152748301
+
+#include "../eventpolicies.h"
+#include "../eventdispatcher.h"
+#include "../typeutil.h"
+
+#include <string>
+#include <tuple>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+namespace eventpp {
+
+enum class ReplayPace
+{
+	// Replay the events one after another without waiting.
+	fastest,
+	// Replay each event at the same time offset as it was recorded.
+	recorded
+};
+
+// Records the dispatched events with timestamps to a file, and replays the file.
+// The events are serialized by the same policy functions as MixinJournal,
+//	static void serializeEvent(std::string & data, const Event & e, const Args & ...args);
+//	static bool deserializeEvent(const char * data, std::size_t size, Event & e, Args & ...args);
+// File layout: the magic "EVPPREC1", then each record is the nanoseconds since the previous record
+// and the payload size, both are LEB128 variable length integers, followed by the payload.
+template <typename Base>
+class MixinRecorder : public Base
+{
+private:
+	using super = Base;
+
+	using Event = typename super::Event;
+	using Mutex = typename super::Mutex;
+	using Threading = typename super::Threading;
+	using Policies = typename super::Policies;
+	using Prototype = typename super::Prototype;
+
+	template <typename P>
+	struct MakeRecordedEvent;
+
+	template <typename RT, typename ...A>
+	struct MakeRecordedEvent <RT (A...)>
+	{
+		using Type = std::tuple<
+			typename std::remove_cv<typename std::remove_reference<Event>::type>::type,
+			typename std::remove_cv<typename std::remove_reference<A>::type>::type...
+		>;
+	};
+
+	enum { argumentCount = CountArguments<Prototype>::value };
+
+	enum : std::size_t {
+		magicSize = 8,
+		// The buffered records are written to the file when the buffer exceeds the size.
+		writeBufferSize = 64 * 1024,
+		// A larger size in the file is treated as corrupted.
+		maxPayloadSize = 1024 * 1024 * 1024
+	};
+
+	static const char * getMagic() {
+		return "EVPPREC1";
+	}
+
+public:
+	using Clock = std::chrono::steady_clock;
+	// The event and the arguments, same as EventQueue::QueuedEvent.
+	using RecordedEvent = typename MakeRecordedEvent<Prototype>::Type;
+
+public:
+	MixinRecorder()
+		:
+			super(),
+			recording(false),
+			recorderMutex(),
+			file(nullptr),
+			writeBuffer(),
+			payloadBuffer(),
+			lastRecordTime(),
+			recordedCount(0),
+			writeFailed(false)
+	{
+	}
+
+	~MixinRecorder()
+	{
+		stopRecording();
+	}
+
+	// Start recording the dispatched events to the file, the file is overwritten.
+	// Return false if the file can't be created.
+	bool startRecording(const std::string & fileName)
+	{
+		stopRecording();
+
+		std::lock_guard<Mutex> lockGuard(recorderMutex);
+		file = std::fopen(fileName.c_str(), "wb");
+		if(file == nullptr) {
+			return false;
+		}
+		writeBuffer.assign(getMagic(), magicSize);
+		lastRecordTime = Clock::now();
+		recordedCount = 0;
+		writeFailed = false;
+		recording.store(true, std::memory_order_release);
+		return true;
+	}
+
+	// Write the buffered records and close the file. Return false if any record can't be written.
+	bool stopRecording()
+	{
+		std::lock_guard<Mutex> lockGuard(recorderMutex);
+		if(file == nullptr) {
+			return true;
+		}
+		recording.store(false, std::memory_order_release);
+		doFlush();
+		if(std::fclose(file) != 0) {
+			writeFailed = true;
+		}
+		file = nullptr;
+		return ! writeFailed;
+	}
+
+	bool isRecording() const {
+		return recording.load(std::memory_order_acquire);
+	}
+
+	std::size_t getRecordedCount() const {
+		std::lock_guard<Mutex> lockGuard(recorderMutex);
+		return recordedCount;
+	}
+
+	// Dispatch the events in the file, either as fast as possible, or at the recorded pace.
+	// Return the count of dispatched events, the replay stops at the first invalid record.
+	std::size_t replayRecording(const std::string & fileName, const ReplayPace pace = ReplayPace::fastest)
+	{
+		return readRecording(fileName, pace, [this](RecordedEvent & recordedEvent) {
+			doDispatchRecordedEvent(
+				recordedEvent,
+				typename internal_::MakeIndexSequence<std::tuple_size<RecordedEvent>::value - 1>::Type()
+			);
+		});
+	}
+
+	// Invoke func(RecordedEvent &) on each event in the file, either as fast as possible, or at the recorded pace.
+	// It's useful to feed the events to another dispatcher or queue.
+	// Return the count of the events, the reading stops at the first invalid record.
+	template <typename F>
+	static std::size_t readRecording(const std::string & fileName, const ReplayPace pace, F && func)
+	{
+		std::FILE * inputFile = std::fopen(fileName.c_str(), "rb");
+		if(inputFile == nullptr) {
+			return 0;
+		}
+
+		std::size_t count = 0;
+		char magic[magicSize];
+		if(std::fread(magic, 1, magicSize, inputFile) == magicSize && std::memcmp(magic, getMagic(), magicSize) == 0) {
+			const Clock::time_point startTime = Clock::now();
+			uint64_t timestamp = 0;
+			uint64_t delta = 0;
+			uint64_t size = 0;
+			std::string payload;
+			while(doReadNumber(inputFile, &delta) && doReadNumber(inputFile, &size)) {
+				if(size > maxPayloadSize) {
+					break;
+				}
+				payload.resize((std::size_t)size);
+				if(size > 0 && std::fread(&payload[0], 1, (std::size_t)size, inputFile) != size) {
+					break;
+				}
+
+				RecordedEvent recordedEvent;
+				if(! doDeserialize(
+					payload.data(),
+					payload.size(),
+					recordedEvent,
+					typename internal_::MakeIndexSequence<std::tuple_size<RecordedEvent>::value>::Type()
+				)) {
+					break;
+				}
+
+				timestamp += delta;
+				if(pace == ReplayPace::recorded) {
+					std::this_thread::sleep_until(startTime + std::chrono::nanoseconds(timestamp));
+				}
+				func(recordedEvent);
+				++count;
+			}
+		}
+		std::fclose(inputFile);
+
+		return count;
+	}
+
+	template <typename ...A>
+	auto mixinBeforeDispatch(const Event & e, A & ...args) const
+		-> typename std::enable_if<sizeof...(A) == argumentCount, bool>::type
+	{
+		if(recording.load(std::memory_order_acquire)) {
+			doRecord(e, args...);
+		}
+		return true;
+	}
+
+private:
+	template <typename ...A>
+	void doRecord(const Event & e, const A & ...args) const
+	{
+		static_assert(internal_::HasFunctionSerializeEvent<Policies, Event, A...>::value,
+			"MixinRecorder requires the policy function serializeEvent.");
+
+		std::lock_guard<Mutex> lockGuard(recorderMutex);
+		if(file == nullptr) {
+			return;
+		}
+
+		// The time is read in the lock, so the records are in time order.
+		const Clock::time_point now = Clock::now();
+		const uint64_t delta = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastRecordTime).count();
+		lastRecordTime = now;
+
+		payloadBuffer.clear();
+		Policies::serializeEvent(payloadBuffer, e, args...);
+		doWriteNumber(delta);
+		doWriteNumber(payloadBuffer.size());
+		writeBuffer.append(payloadBuffer);
+		++recordedCount;
+
+		if(writeBuffer.size() >= writeBufferSize) {
+			doFlush();
+		}
+	}
+
+	// Must be called with recorderMutex locked.
+	void doFlush() const
+	{
+		if(! writeBuffer.empty()) {
+			if(std::fwrite(writeBuffer.data(), 1, writeBuffer.size(), file) != writeBuffer.size()) {
+				writeFailed = true;
+			}
+			writeBuffer.clear();
+		}
+	}
+
+	void doWriteNumber(uint64_t value) const
+	{
+		while(value >= 0x80) {
+			writeBuffer.push_back((char)((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		writeBuffer.push_back((char)value);
+	}
+
+	static bool doReadNumber(std::FILE * inputFile, uint64_t * value)
+	{
+		*value = 0;
+		for(int shift = 0; shift < 64; shift += 7) {
+			const int c = std::fgetc(inputFile);
+			if(c == EOF) {
+				return false;
+			}
+			*value |= (uint64_t)(c & 0x7f) << shift;
+			if((c & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <size_t ...Indexes>
+	static bool doDeserialize(const char * data, const std::size_t size, RecordedEvent & recordedEvent, internal_::IndexSequence<Indexes...>)
+	{
+		static_assert(internal_::HasFunctionDeserializeEvent<Policies, typename std::tuple_element<Indexes, RecordedEvent>::type...>::value,
+			"MixinRecorder requires the policy function deserializeEvent.");
+		return Policies::deserializeEvent(data, size, std::get<Indexes>(recordedEvent)...);
+	}
+
+	// The recorded event is passed to the listeners directly, even if the event is calculated by getEvent.
+	template <size_t ...Indexes>
+	void doDispatchRecordedEvent(RecordedEvent & recordedEvent, internal_::IndexSequence<Indexes...>)
+	{
+		this->doDispatch(std::get<0>(recordedEvent), std::move(std::get<Indexes + 1>(recordedEvent))...);
+	}
+
+private:
+	typename Threading::template Atomic<bool> recording;
+	mutable Mutex recorderMutex;
+	std::FILE * file;
+	mutable std::string writeBuffer;
+	mutable std::string payloadBuffer;
+	mutable Clock::time_point lastRecordTime;
+	mutable std::size_t recordedCount;
+	mutable bool writeFailed;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,348 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINSTAGEDENQUEUE_H_640183927514
+#define MIXINSTAGEDENQUEUE_H_640183927514
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+namespace eventpp {
+
+// Only for EventQueue. Adds enqueueStaged which appends the event to a staging buffer of the calling thread.
+// The buffer is published to the queue in one batch when it's full, when its oldest event is staged for longer than
+// the max staging delay, when flushStaged or flushAllStaged is called, or when the consumer processes or waits for the queue.
+// The waiting consumer is woken up when a buffer becomes non-empty. So the producers only touch the shared queue once per batch.
+template <typename Base>
+class MixinStagedEnqueue : public Base
+{
+private:
+	using super = Base;
+
+	using Mutex = typename super::Mutex;
+	using Threading = typename super::Threading;
+	using QueuedEvent = typename super::QueuedEvent;
+
+	struct StagingBuffer
+	{
+		StagingBuffer() : mutex(), eventList(), oldestTime(), closed(false), threadExited(false)
+		{
+		}
+
+		Mutex mutex;
+		std::vector<QueuedEvent> eventList;
+		// The time the first event in eventList is staged.
+		std::chrono::steady_clock::time_point oldestTime;
+		// The queue is destroyed.
+		typename Threading::template Atomic<bool> closed;
+		// The producer thread is exited, the buffer is removed after it's flushed.
+		typename Threading::template Atomic<bool> threadExited;
+	};
+
+	using BufferPointer = std::shared_ptr<StagingBuffer>;
+
+	struct ThreadBufferList
+	{
+		~ThreadBufferList()
+		{
+			for(auto & item : bufferList) {
+				item.second->threadExited.store(true, std::memory_order_release);
+			}
+		}
+
+		std::vector<std::pair<uint64_t, BufferPointer> > bufferList;
+	};
+
+public:
+	using Clock = std::chrono::steady_clock;
+
+public:
+	MixinStagedEnqueue()
+		:
+			super(),
+			queueId(getNextQueueId()),
+			stagingCapacity(64),
+			maxStagingDelay(0),
+			stagedCount(0),
+			bufferListMutex(),
+			bufferList()
+	{
+	}
+
+	~MixinStagedEnqueue()
+	{
+		std::lock_guard<Mutex> lockGuard(bufferListMutex);
+		for(auto & buffer : bufferList) {
+			buffer->closed.store(true, std::memory_order_release);
+		}
+	}
+
+	// Same arguments as enqueue. The event is published to the queue when the staging buffer of the calling thread
+	// has stagingCapacity events, when its oldest event is staged for maxStagingDelay, or when it's flushed.
+	// The events from the same thread keep their order.
+	template <typename ...A>
+	void enqueueStaged(A && ...args)
+	{
+		StagingBuffer & buffer = getThreadBuffer();
+
+		bool wasEmpty;
+		{
+			std::lock_guard<Mutex> lockGuard(buffer.mutex);
+			wasEmpty = buffer.eventList.empty();
+			buffer.eventList.push_back(this->doMakeQueuedEvent(std::forward<A>(args)...));
+			stagedCount.fetch_add(1, std::memory_order_release);
+			// The clock is read once per batch, and on each event only if the delay is limited.
+			const Clock::rep delay = maxStagingDelay.load(std::memory_order_relaxed);
+			if(wasEmpty) {
+				buffer.oldestTime = Clock::now();
+			}
+			if(buffer.eventList.size() >= stagingCapacity.load(std::memory_order_relaxed)
+				|| (delay != 0 && ! wasEmpty && Clock::now() - buffer.oldestTime >= Clock::duration(delay))
+			) {
+				doPublish(buffer);
+			}
+		}
+		// Wake up the waiting consumer to publish the buffer, once per batch.
+		if(wasEmpty) {
+			this->doWakeUpWaiters();
+		}
+	}
+
+	// Publish the staged events of the calling thread.
+	void flushStaged()
+	{
+		StagingBuffer & buffer = getThreadBuffer();
+
+		std::lock_guard<Mutex> lockGuard(buffer.mutex);
+		doPublish(buffer);
+	}
+
+	// Publish the staged events of all threads. It's called by the process functions, wait and waitFor.
+	// Nothing is locked if no event is staged.
+	void flushAllStaged()
+	{
+		if(stagedCount.load(std::memory_order_acquire) == 0) {
+			return;
+		}
+
+		std::lock_guard<Mutex> lockGuard(bufferListMutex);
+
+		for(auto it = bufferList.begin(); it != bufferList.end(); ) {
+			StagingBuffer & buffer = **it;
+			const bool threadExited = buffer.threadExited.load(std::memory_order_acquire);
+			{
+				std::lock_guard<Mutex> bufferLock(buffer.mutex);
+				doPublish(buffer);
+			}
+			if(threadExited) {
+				it = bufferList.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	// The staging buffer of a thread is published when it has count events. Default is 64.
+	void setStagingCapacity(const std::size_t count) {
+		stagingCapacity.store(count > 0 ? count : 1, std::memory_order_relaxed);
+	}
+
+	std::size_t getStagingCapacity() const {
+		return stagingCapacity.load(std::memory_order_relaxed);
+	}
+
+	// The staging buffer of a thread is published when the thread stages an event and the oldest event
+	// in the buffer is staged for delay or longer. Zero, the default, means no limit.
+	// The consumer still publishes all buffers when it processes or waits, regardless of the delay.
+	template <class Rep, class Period>
+	void setMaxStagingDelay(const std::chrono::duration<Rep, Period> & delay) {
+		maxStagingDelay.store(
+			delay.count() > 0 ? std::max<Clock::rep>(std::chrono::duration_cast<Clock::duration>(delay).count(), 1) : 0,
+			std::memory_order_relaxed
+		);
+	}
+
+	Clock::duration getMaxStagingDelay() const {
+		return Clock::duration(maxStagingDelay.load(std::memory_order_relaxed));
+	}
+
+	void process()
+	{
+		flushAllStaged();
+		super::process();
+	}
+
+	bool processOne()
+	{
+		flushAllStaged();
+		return super::processOne();
+	}
+
+	std::size_t processCount(const std::size_t count)
+	{
+		flushAllStaged();
+		return super::processCount(count);
+	}
+
+	template <class C, class Duration>
+	std::size_t processUntil(const std::chrono::time_point<C, Duration> & timePoint)
+	{
+		flushAllStaged();
+		return super::processUntil(timePoint);
+	}
+
+	template <class Rep, class Period>
+	std::size_t processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		flushAllStaged();
+		return super::processFor(duration);
+	}
+
+	std::size_t processReady()
+	{
+		flushAllStaged();
+		return super::processReady();
+	}
+
+	// Only available if a mixin under this one, such as MixinParallelProcess, has processParallel.
+	template <typename B = super, typename ...A>
+	auto processParallel(A && ...args)
+		-> decltype(std::declval<B &>().processParallel(std::forward<A>(args)...))
+	{
+		flushAllStaged();
+		return B::processParallel(std::forward<A>(args)...);
+	}
+
+	// Only available if a mixin under this one, such as MixinParallelProcess, has processPartitioned.
+	template <typename B = super, typename ...A>
+	auto processPartitioned(A && ...args)
+		-> decltype(std::declval<B &>().processPartitioned(std::forward<A>(args)...))
+	{
+		flushAllStaged();
+		return B::processPartitioned(std::forward<A>(args)...);
+	}
+
+	// The wake up counter is read before the staging buffers are flushed, so an event staged
+	// after the flush wakes up the waiting instead of being missed.
+	void wait()
+	{
+		for(;;) {
+			const unsigned int wakeUpCounter = this->doGetWakeUpCounter();
+			flushAllStaged();
+			if(this->doCanProcess()) {
+				return;
+			}
+			this->doWait(wakeUpCounter);
+		}
+	}
+
+	template <class Rep, class Period>
+	bool waitFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		const Clock::time_point deadline = Clock::now() + duration;
+		for(;;) {
+			const unsigned int wakeUpCounter = this->doGetWakeUpCounter();
+			flushAllStaged();
+			if(this->doCanProcess()) {
+				return true;
+			}
+
+			const Clock::time_point now = Clock::now();
+			if(now >= deadline) {
+				return false;
+			}
+			this->doWaitFor(deadline - now, wakeUpCounter);
+		}
+	}
+
+private:
+	// Must be called with buffer.mutex locked, so the batches from the same buffer are published in order.
+	void doPublish(StagingBuffer & buffer)
+	{
+		if(! buffer.eventList.empty()) {
+			const std::size_t count = buffer.eventList.size();
+			this->enqueueBatch(
+				std::make_move_iterator(buffer.eventList.begin()),
+				std::make_move_iterator(buffer.eventList.end())
+			);
+			buffer.eventList.clear();
+			stagedCount.fetch_sub(count, std::memory_order_release);
+		}
+	}
+
+	StagingBuffer & getThreadBuffer()
+	{
+		ThreadBufferList & threadBufferList = getThreadBufferList();
+		for(auto & item : threadBufferList.bufferList) {
+			if(item.first == queueId) {
+				return *item.second;
+			}
+		}
+
+		// Remove the buffers of the destroyed queues.
+		auto & list = threadBufferList.bufferList;
+		for(auto it = list.begin(); it != list.end(); ) {
+			if(it->second->closed.load(std::memory_order_acquire)) {
+				it = list.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+
+		BufferPointer buffer = std::make_shared<StagingBuffer>();
+		buffer->eventList.reserve(stagingCapacity.load(std::memory_order_relaxed));
+		{
+			std::lock_guard<Mutex> lockGuard(bufferListMutex);
+			bufferList.push_back(buffer);
+		}
+		list.emplace_back(queueId, buffer);
+		return *buffer;
+	}
+
+	static ThreadBufferList & getThreadBufferList() {
+		static thread_local ThreadBufferList threadBufferList;
+		return threadBufferList;
+	}
+
+	// The ids are never reused, so a thread never sees the buffer of a destroyed queue at the same address.
+	static uint64_t getNextQueueId() {
+		static std::atomic<uint64_t> nextQueueId(0);
+		return ++nextQueueId;
+	}
+
+private:
+	const uint64_t queueId;
+	typename Threading::template Atomic<std::size_t> stagingCapacity;
+	typename Threading::template Atomic<Clock::rep> maxStagingDelay;
+	// The count of the events in all staging buffers, flushAllStaged skips locking if it's zero.
+	typename Threading::template Atomic<std::size_t> stagedCount;
+	Mutex bufferListMutex;
+	std::vector<BufferPointer> bufferList;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,84 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINSTATICFILTER_H_290374826159
+#define MIXINSTATICFILTER_H_290374826159
+
+#include <tuple>
+#include <type_traits>
+#include <cstddef>
+
+namespace eventpp {
+
+// The filters are fixed at compile time, each filter is a default constructible callable type.
+// There is no type erasure, lock, or allocation, the compiler can inline the whole filter chain.
+// Usage: using Mixins = eventpp::MixinList<eventpp::MixinStaticFilter<FilterA, FilterB>::Mixin>;
+template <typename ...Filters>
+struct MixinStaticFilter
+{
+	template <typename Base>
+	class Mixin : public Base
+	{
+	private:
+		using super = Base;
+		using FilterTuple = std::tuple<Filters...>;
+
+	public:
+		template <std::size_t N>
+		using Filter = typename std::tuple_element<N, FilterTuple>::type;
+
+	public:
+		template <std::size_t N>
+		Filter<N> & getStaticFilter() {
+			return std::get<N>(filters);
+		}
+
+		template <std::size_t N>
+		const Filter<N> & getStaticFilter() const {
+			return std::get<N>(filters);
+		}
+
+		template <typename ...Args>
+		bool mixinBeforeDispatch(Args && ...args) const {
+			return doFilter(std::integral_constant<std::size_t, 0>(), args...);
+		}
+
+	private:
+		template <std::size_t N, typename ...Args>
+		auto doFilter(std::integral_constant<std::size_t, N>, Args & ...args) const
+			-> typename std::enable_if<(N < sizeof...(Filters)), bool>::type
+		{
+			if(! std::get<N>(filters)(args...)) {
+				return false;
+			}
+			return doFilter(std::integral_constant<std::size_t, N + 1>(), args...);
+		}
+
+		template <std::size_t N, typename ...Args>
+		auto doFilter(std::integral_constant<std::size_t, N>, Args & .../*args*/) const
+			-> typename std::enable_if<(N >= sizeof...(Filters)), bool>::type
+		{
+			return true;
+		}
+
+	private:
+		// mutable because the filters are invoked in the const dispatch, and filters may have states.
+		mutable FilterTuple filters;
+	};
+};
+
+
+} //namespace eventpp
+
+
+#endif
@@ -0,0 +1,264 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MIXINTIMEDQUEUE_H_093851627403
+#define MIXINTIMEDQUEUE_H_093851627403
+
+#include "../timingwheel.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+
+namespace eventpp {
+
+// Only for EventQueue. Adds enqueueAfter and enqueueAt, the timed events are held in a TimingWheel
+// with 1 millisecond resolution, and moved to the queue when they are due.
+template <typename Base>
+class MixinTimedQueue : public Base
+{
+private:
+	using super = Base;
+
+	using Mutex = typename super::Mutex;
+	using QueuedEvent = typename super::QueuedEvent;
+	using Wheel = TimingWheel<QueuedEvent>;
+
+public:
+	using Clock = std::chrono::steady_clock;
+	using TimerHandle = typename Wheel::Handle;
+
+public:
+	MixinTimedQueue()
+		:
+			super(),
+			startTime(Clock::now()),
+			timingWheel(),
+			pendingList(),
+			timerMutex()
+	{
+	}
+
+	// The event is enqueued when the time point is reached, not earlier.
+	// Same as enqueue, the arguments are either with or without the event type.
+	template <typename ...A>
+	TimerHandle enqueueAt(const Clock::time_point & timePoint, A && ...args)
+	{
+		TimerHandle handle;
+		bool earlier;
+		{
+			std::lock_guard<Mutex> lockGuard(timerMutex);
+
+			const uint64_t nextTick = timingWheel.getNextTick();
+			handle = timingWheel.add(getExpireTick(timePoint), this->doMakeQueuedEvent(std::forward<A>(args)...));
+			earlier = timingWheel.getNextTick() < nextTick;
+		}
+
+		// The waiting threads need to wake up earlier.
+		if(earlier) {
+			this->doWakeUpWaiters();
+		}
+
+		return handle;
+	}
+
+	template <typename Rep, typename Period, typename ...A>
+	TimerHandle enqueueAfter(const std::chrono::duration<Rep, Period> & delay, A && ...args)
+	{
+		return enqueueAt(Clock::now() + delay, std::forward<A>(args)...);
+	}
+
+	// Return false if the event has been enqueued or cancelled.
+	bool cancelTimer(const TimerHandle & handle)
+	{
+		std::lock_guard<Mutex> lockGuard(timerMutex);
+		return timingWheel.cancel(handle);
+	}
+
+	// The count of the timed events which are not due yet.
+	std::size_t getTimerCount() const
+	{
+		std::lock_guard<Mutex> lockGuard(timerMutex);
+		return timingWheel.size();
+	}
+
+	// Move the due events to the queue. It's called by process() and the other process functions.
+	// The due events are collected under the lock and enqueued after the lock is released, without blocking,
+	// since it runs in the consumer thread and a blocking queue list may wait for the consumer itself.
+	// The events which the queue list doesn't accept are kept in order and enqueued by the next call.
+	void releaseDueEvents()
+	{
+		const uint64_t tick = getCurrentTick();
+
+		std::vector<QueuedEvent> dueList;
+		{
+			std::lock_guard<Mutex> lockGuard(timerMutex);
+			if(pendingList.empty() && timingWheel.getNextTick() > tick) {
+				return;
+			}
+			dueList.swap(pendingList);
+			if(timingWheel.getNextTick() <= tick) {
+				timingWheel.advance(tick, [&dueList](QueuedEvent & queuedEvent) {
+					dueList.push_back(std::move(queuedEvent));
+				});
+			}
+		}
+
+		auto it = dueList.begin();
+		while(it != dueList.end() && this->doTryEnqueueQueuedEvent(std::move(*it))) {
+			++it;
+		}
+		if(it != dueList.end()) {
+			std::lock_guard<Mutex> lockGuard(timerMutex);
+			pendingList.insert(pendingList.begin(), std::make_move_iterator(it), std::make_move_iterator(dueList.end()));
+		}
+	}
+
+	void process()
+	{
+		releaseDueEvents();
+		super::process();
+	}
+
+	bool processOne()
+	{
+		releaseDueEvents();
+		return super::processOne();
+	}
+
+	std::size_t processCount(const std::size_t count)
+	{
+		releaseDueEvents();
+		return super::processCount(count);
+	}
+
+	template <class C, class Duration>
+	std::size_t processUntil(const std::chrono::time_point<C, Duration> & timePoint)
+	{
+		releaseDueEvents();
+		return super::processUntil(timePoint);
+	}
+
+	template <class Rep, class Period>
+	std::size_t processFor(const std::chrono::duration<Rep, Period> & duration)
+	{
+		releaseDueEvents();
+		return super::processFor(duration);
+	}
+
+	// The ready descriptor only tells the queued events, the timed events are released when the queue is processed.
+	std::size_t processReady()
+	{
+		releaseDueEvents();
+		return super::processReady();
+	}
+
+	// Wait until the queue is not empty or any timed event is due.
+	// The wake up counter is read before the timers are checked, so a timer added by enqueueAt
+	// after the check wakes up the waiting instead of being missed.
+	void wait() const
+	{
+		for(;;) {
+			const unsigned int wakeUpCounter = this->doGetWakeUpCounter();
+			if(this->doCanProcess()) {
+				return;
+			}
+
+			Clock::time_point nextTime;
+			if(! getNextTime(&nextTime)) {
+				this->doWait(wakeUpCounter);
+			}
+			else {
+				const Clock::time_point now = Clock::now();
+				if(nextTime <= now) {
+					return;
+				}
+				this->doWaitFor(nextTime - now, wakeUpCounter);
+			}
+		}
+	}
+
+	template <class Rep, class Period>
+	bool waitFor(const std::chrono::duration<Rep, Period> & duration) const
+	{
+		const Clock::time_point deadline = Clock::now() + duration;
+		for(;;) {
+			const unsigned int wakeUpCounter = this->doGetWakeUpCounter();
+			if(this->doCanProcess()) {
+				return true;
+			}
+
+			const Clock::time_point now = Clock::now();
+			Clock::time_point nextTime;
+			const bool hasTimer = getNextTime(&nextTime);
+			if(hasTimer && nextTime <= now) {
+				return true;
+			}
+			if(now >= deadline) {
+				return false;
+			}
+
+			this->doWaitFor((hasTimer && nextTime < deadline ? nextTime : deadline) - now, wakeUpCounter);
+		}
+	}
+
+private:
+	uint64_t getCurrentTick() const {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime).count();
+	}
+
+	// Round up so the event is never enqueued earlier than timePoint.
+	uint64_t getExpireTick(const Clock::time_point & timePoint) const {
+		if(timePoint <= startTime) {
+			return 0;
+		}
+		const auto duration = timePoint - startTime;
+		auto tick = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+		if(tick < duration) {
+			++tick;
+		}
+		return (uint64_t)tick.count();
+	}
+
+	bool getNextTime(Clock::time_point * nextTime) const
+	{
+		std::lock_guard<Mutex> lockGuard(timerMutex);
+		// The due events which the queue list didn't accept are due now.
+		if(! pendingList.empty()) {
+			*nextTime = startTime;
+			return true;
+		}
+		if(timingWheel.empty()) {
+			return false;
+		}
+		*nextTime = startTime + std::chrono::milliseconds(timingWheel.getNextTick());
+		return true;
+	}
+
+private:
+	const Clock::time_point startTime;
+	Wheel timingWheel;
+	// The due events which are not accepted by the queue list yet, such as a full RingQueueList.
+	std::vector<QueuedEvent> pendingList;
+	mutable Mutex timerMutex;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,487 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ARENAQUEUELIST_H_530718264903
+#define ARENAQUEUELIST_H_530718264903
+
+#include "../eventpolicies.h"
+#include "../eventdispatcher.h"
+
+#include <string>
+#include <tuple>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstring>
+#include <cstddef>
+
+namespace eventpp {
+
+// A view of a sequence of bytes, it doesn't own the bytes.
+// When a ByteView argument is queued in ArenaQueueList, the bytes are copied into the arena,
+// and the listeners receive a ByteView pointing into the arena.
+class ByteView
+{
+public:
+	ByteView() : data(nullptr), size(0)
+	{
+	}
+
+	ByteView(const void * bytes, const std::size_t byteCount)
+		: data(static_cast<const char *>(bytes)), size(byteCount)
+	{
+	}
+
+	ByteView(const std::string & s)
+		: data(s.data()), size(s.size())
+	{
+	}
+
+	ByteView(const char * s)
+		: data(s), size(s == nullptr ? 0 : std::strlen(s))
+	{
+	}
+
+	const char * getData() const {
+		return data;
+	}
+
+	std::size_t getSize() const {
+		return size;
+	}
+
+	bool empty() const {
+		return size == 0;
+	}
+
+	const char * begin() const {
+		return data;
+	}
+
+	const char * end() const {
+		return data + size;
+	}
+
+	std::string toString() const {
+		return std::string(data, size);
+	}
+
+	bool operator == (const ByteView & other) const {
+		return size == other.size && (size == 0 || std::memcmp(data, other.data, size) == 0);
+	}
+
+	bool operator != (const ByteView & other) const {
+		return ! operator == (other);
+	}
+
+private:
+	const char * data;
+	std::size_t size;
+};
+
+// The queued items and the bytes of their ByteView arguments are stored together as variable size records,
+// which are bump allocated in chunks of ChunkBytes bytes. A record larger than ChunkBytes gets its own chunk.
+// Enqueuing copies the bytes once and doesn't allocate unless a new chunk is needed, and the chunks are
+// recycled as a whole after their records are dispatched, in the next consume.
+// The ByteView arguments received by the listeners are valid until the listeners return. The ByteView in the event
+// taken by takeEvent or peekEvent is valid until the next process or takeEvent, copy the bytes to keep them longer.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::ArenaQueueList<>::QueueList<Item, P>; };
+template <std::size_t ChunkBytes = 64 * 1024>
+struct ArenaQueueList
+{
+	template <typename T, typename Policies>
+	class QueueList
+	{
+	private:
+		using Threading = typename internal_::SelectThreading<Policies, internal_::HasTypeThreading<Policies>::value>::Type;
+		using Mutex = typename Threading::Mutex;
+
+		static_assert(std::alignment_of<T>::value <= std::alignment_of<std::max_align_t>::value,
+			"ArenaQueueList doesn't support over aligned events.");
+
+		struct RecordHeader
+		{
+			// The size of the whole record, including the header, the item and the bytes.
+			std::size_t size;
+		};
+
+		enum : std::size_t {
+			recordAlignment = std::alignment_of<T>::value > std::alignment_of<RecordHeader>::value
+				? std::alignment_of<T>::value : std::alignment_of<RecordHeader>::value,
+			itemOffset = (sizeof(RecordHeader) + recordAlignment - 1) / recordAlignment * recordAlignment,
+			bytesOffset = itemOffset + sizeof(T)
+		};
+
+		struct Chunk
+		{
+			explicit Chunk(const std::size_t capacity)
+				: capacity(capacity), size(0), doneSize(0), sealed(false), next(nullptr)
+			{
+			}
+
+			char * getData() {
+				return reinterpret_cast<char *>(this) + dataOffset;
+			}
+
+			RecordHeader * getRecord(const std::size_t offset) {
+				return reinterpret_cast<RecordHeader *>(getData() + offset);
+			}
+
+			T & getItem(const std::size_t offset) {
+				return *reinterpret_cast<T *>(getData() + offset + itemOffset);
+			}
+
+			std::size_t capacity;
+			// The bytes used by the records.
+			std::size_t size;
+			// The bytes of the dispatched records.
+			std::size_t doneSize;
+			// A sealed chunk doesn't receive records any more, it's retired when doneSize reaches size.
+			bool sealed;
+			Chunk * next;
+		};
+
+		enum : std::size_t {
+			dataOffset = (sizeof(Chunk) + std::alignment_of<std::max_align_t>::value - 1)
+				/ std::alignment_of<std::max_align_t>::value * std::alignment_of<std::max_align_t>::value
+		};
+
+	public:
+		QueueList()
+			:
+				headChunk(nullptr),
+				tailChunk(nullptr),
+				readOffset(0),
+				freeChunk(nullptr),
+				retiredChunk(nullptr),
+				allocatedSize(0),
+				queuedCount(0),
+				mutex()
+		{
+		}
+
+		~QueueList()
+		{
+			consume([](T &) {}, (std::size_t)-1);
+			doRecycleRetiredChunks();
+			while(freeChunk != nullptr) {
+				Chunk * next = freeChunk->next;
+				doDestroyChunk(freeChunk);
+				freeChunk = next;
+			}
+		}
+
+		QueueList(QueueList &&) = delete;
+		QueueList(const QueueList &) = delete;
+		QueueList & operator = (const QueueList &) = delete;
+
+		bool empty() const {
+			return queuedCount.load(std::memory_order_acquire) == 0;
+		}
+
+		template <typename ...A>
+		bool emplace(A && ...args)
+		{
+			T item(std::forward<A>(args)...);
+
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			doEmplaceBack(item);
+			queuedCount.fetch_add(1, std::memory_order_release);
+
+			return true;
+		}
+
+		template <typename ...A>
+		bool tryEmplace(A && ...args)
+		{
+			return emplace(std::forward<A>(args)...);
+		}
+
+		// All items are copied into the arena in one lock.
+		template <typename Iterator>
+		std::size_t emplaceRange(Iterator first, Iterator last)
+		{
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			std::size_t count = 0;
+			for(; first != last; ++first) {
+				T item(*first);
+				doEmplaceBack(item);
+				++count;
+			}
+			queuedCount.fetch_add(count, std::memory_order_release);
+
+			return count;
+		}
+
+		template <typename F>
+		std::size_t consume(F && func, const std::size_t maxCount)
+		{
+			if(empty() || maxCount == 0) {
+				return 0;
+			}
+
+			// Detach the records under the lock, and invoke func out of the lock.
+			// The detached records are owned by this call, the producers only write after them.
+			Chunk * firstChunk;
+			std::size_t firstOffset;
+			Chunk * lastChunk;
+			std::size_t lastEndOffset;
+			std::size_t count;
+			{
+				std::lock_guard<Mutex> lockGuard(mutex);
+
+				doRecycleRetiredChunks();
+
+				count = queuedCount.load(std::memory_order_relaxed);
+				if(count > maxCount) {
+					count = maxCount;
+				}
+				if(count == 0) {
+					return 0;
+				}
+				firstChunk = headChunk;
+				firstOffset = readOffset;
+				doAdvanceHead(count, &lastChunk, &lastEndOffset);
+				queuedCount.fetch_sub(count, std::memory_order_release);
+			}
+
+			Chunk * chunk = firstChunk;
+			std::size_t offset = firstOffset;
+			for(std::size_t i = 0; i < count; ++i) {
+				// The chunks before lastChunk are sealed, their size doesn't change any more.
+				if(chunk != lastChunk && offset == chunk->size) {
+					chunk = chunk->next;
+					offset = 0;
+				}
+				T & item = chunk->getItem(offset);
+				func(item);
+				item.~T();
+				offset += chunk->getRecord(offset)->size;
+			}
+
+			{
+				std::lock_guard<Mutex> lockGuard(mutex);
+
+				chunk = firstChunk;
+				offset = firstOffset;
+				for(;;) {
+					const bool isLast = (chunk == lastChunk);
+					Chunk * next = chunk->next;
+					chunk->doneSize += (isLast ? lastEndOffset : chunk->size) - offset;
+					if(chunk->sealed && chunk->doneSize == chunk->size) {
+						chunk->next = retiredChunk;
+						retiredChunk = chunk;
+					}
+					if(isLast) {
+						break;
+					}
+					chunk = next;
+					offset = 0;
+				}
+			}
+
+			return count;
+		}
+
+		bool peek(T * item) const
+		{
+			if(empty()) {
+				return false;
+			}
+
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			if(headChunk == nullptr || readOffset == headChunk->size) {
+				return false;
+			}
+			*item = headChunk->getItem(readOffset);
+			return true;
+		}
+
+		// The bytes allocated by the chunks, including the free chunks.
+		std::size_t getAllocatedSize() const {
+			std::lock_guard<Mutex> lockGuard(mutex);
+			return allocatedSize;
+		}
+
+	private:
+		template <typename U>
+		static std::size_t doGetBytesSize(const U &) {
+			return 0;
+		}
+
+		static std::size_t doGetBytesSize(const ByteView & view) {
+			return view.getSize();
+		}
+
+		template <typename U>
+		static void doCopyBytes(U &, char *&) {
+		}
+
+		static void doCopyBytes(ByteView & view, char *& bytes) {
+			if(! view.empty()) {
+				std::memcpy(bytes, view.getData(), view.getSize());
+			}
+			view = ByteView(bytes, view.getSize());
+			bytes += view.getSize();
+		}
+
+		template <size_t ...Indexes>
+		static std::size_t doGetTotalBytesSize(const T & item, internal_::IndexSequence<Indexes...>)
+		{
+			const std::size_t sizeList[] = { 0, doGetBytesSize(std::get<Indexes>(item))... };
+			std::size_t total = 0;
+			for(const std::size_t size : sizeList) {
+				total += size;
+			}
+			return total;
+		}
+
+		template <size_t ...Indexes>
+		static void doCopyAllBytes(T & item, char * bytes, internal_::IndexSequence<Indexes...>)
+		{
+			const int dummyList[] = { 0, (doCopyBytes(std::get<Indexes>(item), bytes), 0)... };
+			(void)dummyList;
+		}
+
+		// Must be called with mutex locked.
+		void doEmplaceBack(T & item)
+		{
+			using Indexes = typename internal_::MakeIndexSequence<std::tuple_size<T>::value>::Type;
+
+			const std::size_t recordSize = (bytesOffset + doGetTotalBytesSize(item, Indexes()) + recordAlignment - 1)
+				/ recordAlignment * recordAlignment;
+
+			if(tailChunk == nullptr || tailChunk->capacity - tailChunk->size < recordSize) {
+				Chunk * chunk = doAllocateChunk(recordSize);
+				if(tailChunk == nullptr) {
+					headChunk = chunk;
+					readOffset = 0;
+				}
+				else {
+					tailChunk->sealed = true;
+					tailChunk->next = chunk;
+				}
+				tailChunk = chunk;
+			}
+
+			const std::size_t offset = tailChunk->size;
+			tailChunk->getRecord(offset)->size = recordSize;
+			T * queuedItem = new (&tailChunk->getItem(offset)) T(std::move(item));
+			doCopyAllBytes(*queuedItem, tailChunk->getData() + offset + bytesOffset, Indexes());
+			tailChunk->size += recordSize;
+		}
+
+		// Must be called with mutex locked.
+		void doAdvanceHead(const std::size_t count, Chunk ** lastChunk, std::size_t * lastEndOffset)
+		{
+			if(count == queuedCount.load(std::memory_order_relaxed)) {
+				*lastChunk = tailChunk;
+				*lastEndOffset = tailChunk->size;
+			}
+			else {
+				for(std::size_t i = 0; i < count; ++i) {
+					if(readOffset == headChunk->size) {
+						headChunk = headChunk->next;
+						readOffset = 0;
+					}
+					readOffset += headChunk->getRecord(readOffset)->size;
+				}
+				*lastChunk = headChunk;
+				*lastEndOffset = readOffset;
+				if(headChunk != tailChunk && readOffset == headChunk->size) {
+					// Don't leave the head at the end of a sealed chunk, the chunk may be retired before the next consume.
+					headChunk = headChunk->next;
+					readOffset = 0;
+					return;
+				}
+			}
+
+			if(*lastChunk == tailChunk && *lastEndOffset == tailChunk->size) {
+				// All records are detached, remove the chunk from the queue so the producers don't write to it any more.
+				tailChunk->sealed = true;
+				headChunk = nullptr;
+				tailChunk = nullptr;
+				readOffset = 0;
+			}
+		}
+
+		// Must be called with mutex locked.
+		Chunk * doAllocateChunk(const std::size_t recordSize)
+		{
+			if(recordSize > ChunkBytes) {
+				return doCreateChunk(recordSize);
+			}
+			if(freeChunk == nullptr) {
+				return doCreateChunk(ChunkBytes);
+			}
+
+			Chunk * chunk = freeChunk;
+			freeChunk = chunk->next;
+			chunk->next = nullptr;
+			return chunk;
+		}
+
+		// Must be called with mutex locked.
+		// The chunks are not recycled in the consume which retires them, so the events taken by takeEvent are still valid.
+		void doRecycleRetiredChunks()
+		{
+			while(retiredChunk != nullptr) {
+				Chunk * chunk = retiredChunk;
+				retiredChunk = chunk->next;
+				if(chunk->capacity > ChunkBytes) {
+					doDestroyChunk(chunk);
+				}
+				else {
+					chunk->size = 0;
+					chunk->doneSize = 0;
+					chunk->sealed = false;
+					chunk->next = freeChunk;
+					freeChunk = chunk;
+				}
+			}
+		}
+
+		Chunk * doCreateChunk(const std::size_t capacity)
+		{
+			allocatedSize += capacity;
+			return new (::operator new(dataOffset + capacity)) Chunk(capacity);
+		}
+
+		void doDestroyChunk(Chunk * chunk)
+		{
+			allocatedSize -= chunk->capacity;
+			chunk->~Chunk();
+			::operator delete(chunk);
+		}
+
+	private:
+		Chunk * headChunk;
+		Chunk * tailChunk;
+		std::size_t readOffset;
+		Chunk * freeChunk;
+		Chunk * retiredChunk;
+		std::size_t allocatedSize;
+		typename Threading::template Atomic<std::size_t> queuedCount;
+		mutable Mutex mutex;
+	};
+};
+
+
+} //namespace eventpp
+
+
+#endif
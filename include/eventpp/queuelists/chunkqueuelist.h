@@ -0,0 +1,293 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CHUNKQUEUELIST_H_746103958214
+#define CHUNKQUEUELIST_H_746103958214
+
+#include "../eventpolicies.h"
+
+#include <mutex>
+#include <type_traits>
+#include <cstddef>
+
+namespace eventpp {
+
+// The queued items are stored contiguously in chunks of about ChunkBytes bytes.
+// Dispatching walks the items sequentially in memory, and the chunks are recycled as a whole.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::ChunkQueueList<>::QueueList<Item, P>; };
+template <std::size_t ChunkBytes = 4096>
+struct ChunkQueueList
+{
+	template <typename T, typename Policies>
+	class QueueList
+	{
+	private:
+		using Threading = typename internal_::SelectThreading<Policies, internal_::HasTypeThreading<Policies>::value>::Type;
+		using Mutex = typename Threading::Mutex;
+
+		using Slot = typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type;
+
+		enum : std::size_t {
+			slotCount = ChunkBytes / sizeof(T) > 0 ? ChunkBytes / sizeof(T) : 1
+		};
+
+		struct Chunk
+		{
+			Chunk() : slots(), size(0), limit(slotCount), doneCount(0), next(nullptr)
+			{
+			}
+
+			T & get(const std::size_t index) {
+				return *reinterpret_cast<T *>(&slots[index]);
+			}
+
+			Slot slots[slotCount];
+			// The count of constructed items.
+			std::size_t size;
+			// The chunk is recycled when doneCount reaches limit.
+			// limit is reduced to size if the chunk is removed from the queue before it's full.
+			std::size_t limit;
+			std::size_t doneCount;
+			Chunk * next;
+		};
+
+	public:
+		QueueList()
+			:
+				headChunk(nullptr),
+				tailChunk(nullptr),
+				readIndex(0),
+				freeChunk(nullptr),
+				queuedCount(0),
+				mutex()
+		{
+		}
+
+		~QueueList()
+		{
+			consume([](T &) {}, (std::size_t)-1);
+			while(freeChunk != nullptr) {
+				Chunk * next = freeChunk->next;
+				delete freeChunk;
+				freeChunk = next;
+			}
+		}
+
+		QueueList(QueueList &&) = delete;
+		QueueList(const QueueList &) = delete;
+		QueueList & operator = (const QueueList &) = delete;
+
+		bool empty() const {
+			return queuedCount.load(std::memory_order_acquire) == 0;
+		}
+
+		template <typename ...A>
+		bool emplace(A && ...args)
+		{
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			doEmplaceBack(std::forward<A>(args)...);
+			queuedCount.fetch_add(1, std::memory_order_release);
+
+			return true;
+		}
+
+		template <typename ...A>
+		bool tryEmplace(A && ...args)
+		{
+			return emplace(std::forward<A>(args)...);
+		}
+
+		// All items are constructed in one lock.
+		template <typename Iterator>
+		std::size_t emplaceRange(Iterator first, Iterator last)
+		{
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			std::size_t count = 0;
+			for(; first != last; ++first) {
+				doEmplaceBack(*first);
+				++count;
+			}
+			queuedCount.fetch_add(count, std::memory_order_release);
+
+			return count;
+		}
+
+		template <typename F>
+		std::size_t consume(F && func, const std::size_t maxCount)
+		{
+			if(empty() || maxCount == 0) {
+				return 0;
+			}
+
+			// Detach the items under the lock, and invoke func out of the lock.
+			// The detached items are owned by this call, the producers only write after them.
+			Chunk * firstChunk;
+			std::size_t firstIndex;
+			std::size_t count;
+			{
+				std::lock_guard<Mutex> lockGuard(mutex);
+
+				count = queuedCount.load(std::memory_order_relaxed);
+				if(count > maxCount) {
+					count = maxCount;
+				}
+				if(count == 0) {
+					return 0;
+				}
+				firstChunk = headChunk;
+				firstIndex = readIndex;
+				doAdvanceHead(count);
+				queuedCount.fetch_sub(count, std::memory_order_release);
+			}
+
+			Chunk * chunk = firstChunk;
+			std::size_t index = firstIndex;
+			for(std::size_t remaining = count; remaining > 0; ) {
+				const std::size_t end = index + getSpanSize(index, remaining);
+				remaining -= end - index;
+				for(; index < end; ++index) {
+					T & item = chunk->get(index);
+					func(item);
+					item.~T();
+				}
+				if(remaining > 0) {
+					chunk = chunk->next;
+					index = 0;
+				}
+			}
+
+			{
+				std::lock_guard<Mutex> lockGuard(mutex);
+
+				chunk = firstChunk;
+				index = firstIndex;
+				for(std::size_t remaining = count; remaining > 0; ) {
+					const std::size_t spanSize = getSpanSize(index, remaining);
+					remaining -= spanSize;
+					Chunk * next = chunk->next;
+					chunk->doneCount += spanSize;
+					if(chunk->doneCount == chunk->limit) {
+						doFreeChunk(chunk);
+					}
+					chunk = next;
+					index = 0;
+				}
+			}
+
+			return count;
+		}
+
+		bool peek(T * item) const
+		{
+			if(empty()) {
+				return false;
+			}
+
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			if(headChunk == nullptr || readIndex == headChunk->size) {
+				return false;
+			}
+			*item = headChunk->get(readIndex);
+			return true;
+		}
+
+	private:
+		// All chunks except the last one in a detached range are full.
+		static std::size_t getSpanSize(const std::size_t index, const std::size_t remaining) {
+			return slotCount - index < remaining ? slotCount - index : remaining;
+		}
+
+		// Must be called with mutex locked.
+		template <typename ...A>
+		void doEmplaceBack(A && ...args)
+		{
+			if(tailChunk == nullptr || tailChunk->size == slotCount) {
+				Chunk * chunk = doAllocateChunk();
+				if(tailChunk == nullptr) {
+					headChunk = chunk;
+					readIndex = 0;
+				}
+				else {
+					tailChunk->next = chunk;
+				}
+				tailChunk = chunk;
+			}
+
+			new (&tailChunk->slots[tailChunk->size]) T(std::forward<A>(args)...);
+			++tailChunk->size;
+		}
+
+		// Must be called with mutex locked.
+		void doAdvanceHead(std::size_t count)
+		{
+			while(count > 0) {
+				const std::size_t spanSize = getSpanSize(readIndex, count);
+				count -= spanSize;
+				readIndex += spanSize;
+
+				if(headChunk == tailChunk && readIndex == headChunk->size) {
+					// All items are detached, remove the chunk from the queue so the producers don't write to it any more.
+					headChunk->limit = headChunk->size;
+					headChunk = nullptr;
+					tailChunk = nullptr;
+					readIndex = 0;
+				}
+				else if(readIndex == slotCount) {
+					headChunk = headChunk->next;
+					readIndex = 0;
+				}
+			}
+		}
+
+		// Must be called with mutex locked.
+		Chunk * doAllocateChunk()
+		{
+			if(freeChunk == nullptr) {
+				return new Chunk();
+			}
+
+			Chunk * chunk = freeChunk;
+			freeChunk = chunk->next;
+			chunk->next = nullptr;
+			return chunk;
+		}
+
+		// Must be called with mutex locked.
+		void doFreeChunk(Chunk * chunk)
+		{
+			chunk->size = 0;
+			chunk->limit = slotCount;
+			chunk->doneCount = 0;
+			chunk->next = freeChunk;
+			freeChunk = chunk;
+		}
+
+	private:
+		Chunk * headChunk;
+		Chunk * tailChunk;
+		std::size_t readIndex;
+		Chunk * freeChunk;
+		typename Threading::template Atomic<std::size_t> queuedCount;
+		mutable Mutex mutex;
+	};
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
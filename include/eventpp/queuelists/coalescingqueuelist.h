@@ -0,0 +1,248 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COALESCINGQUEUELIST_H_318406592735
+#define COALESCINGQUEUELIST_H_318406592735
+
+#include "../eventpolicies.h"
+#include "../eventdispatcher.h"
+#include "nodequeuelistbase.h"
+
+#include <tuple>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// Call the function with the event and the arguments, so template and overloaded functions are detected too.
+template <typename T, typename QueuedEvent>
+struct HasFunctionGetCoalescingKey;
+
+template <typename T, typename Event, typename ...Args>
+struct HasFunctionGetCoalescingKey <T, std::tuple<Event, Args...> >
+{
+	template <typename C> static std::true_type test(
+		typename std::remove_reference<
+			decltype(C::getCoalescingKey(std::declval<const Event &>(), std::declval<const Args &>()...))
+		>::type *
+	);
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+template <typename Policies, typename QueuedEvent, bool>
+struct SelectCoalescingKey;
+
+template <typename Policies, typename Event, typename ...Args>
+struct SelectCoalescingKey <Policies, std::tuple<Event, Args...>, true>
+{
+	using Type = typename std::decay<
+		decltype(Policies::getCoalescingKey(std::declval<const Event &>(), std::declval<const Args &>()...))
+	>::type;
+
+	template <typename ...A>
+	static Type getCoalescingKey(const A & ...args) {
+		return Policies::getCoalescingKey(args...);
+	}
+};
+
+// By default the key is the event type.
+template <typename Policies, typename Event, typename ...Args>
+struct SelectCoalescingKey <Policies, std::tuple<Event, Args...>, false>
+{
+	using Type = Event;
+
+	template <typename ...A>
+	static Type getCoalescingKey(const Event & e, const A & ...) {
+		return e;
+	}
+};
+
+} //namespace internal_
+
+// Only the latest event of each key is kept. Enqueuing an event whose key is already queued
+// replaces the queued event in place, the event keeps its position in the queue.
+// The key is returned by the policy function getCoalescingKey(const Event & e, const Args & ...args),
+// the default key is the event type. The key type must work with the Map policy, or std::unordered_map/std::map.
+// The queued events must be move assignable.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::CoalescingQueueList<Item, P>; };
+template <typename T, typename Policies>
+class CoalescingQueueList : public internal_::NodeQueueListBase<T, Policies>
+{
+private:
+	using super = internal_::NodeQueueListBase<T, Policies>;
+	using Node = typename super::Node;
+	using Mutex = typename super::Mutex;
+	using QueuedEvent = typename internal_::UnwrapQueuedEvent<T>::Type;
+	using SelectKey = internal_::SelectCoalescingKey<
+		Policies, QueuedEvent, internal_::HasFunctionGetCoalescingKey<Policies, QueuedEvent>::value
+	>;
+
+public:
+	using Key = typename SelectKey::Type;
+
+private:
+	using Map = typename internal_::SelectMap<
+		Key,
+		Node *,
+		Policies,
+		internal_::HasTemplateMap<Policies>::value
+	>::Type;
+
+public:
+	CoalescingQueueList()
+		:
+			super(),
+			headNode(nullptr),
+			tailNode(nullptr),
+			keyMap(),
+			coalescedCount(0)
+	{
+	}
+
+	~CoalescingQueueList()
+	{
+		super::doDestroyNodes(headNode);
+	}
+
+	// The count of queued events, it's never greater than the count of distinct keys.
+	std::size_t size() const {
+		return this->queuedCount.load(std::memory_order_acquire);
+	}
+
+	// The count of the events which replaced a queued event.
+	std::size_t getCoalescedCount() const {
+		std::lock_guard<Mutex> lockGuard(this->queueMutex);
+		return coalescedCount;
+	}
+
+	template <typename ...A>
+	bool emplace(A && ...args)
+	{
+		Key key = SelectKey::getCoalescingKey(args...);
+		// The event is constructed out of the lock.
+		Node * node = this->doCreateNode(std::forward<A>(args)...);
+
+		{
+			std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+			auto result = keyMap.insert(typename Map::value_type(std::move(key), node));
+			if(result.second) {
+				if(tailNode == nullptr) {
+					headNode = node;
+				}
+				else {
+					tailNode->next = node;
+				}
+				tailNode = node;
+				this->queuedCount.fetch_add(1, std::memory_order_release);
+
+				return true;
+			}
+
+			result.first->second->get() = std::move(node->get());
+			++coalescedCount;
+		}
+
+		node->next = nullptr;
+		this->doFreeNodes(node);
+
+		return true;
+	}
+
+	template <typename ...A>
+	bool tryEmplace(A && ...args)
+	{
+		return emplace(std::forward<A>(args)...);
+	}
+
+	template <typename F>
+	std::size_t consume(F && func, const std::size_t maxCount)
+	{
+		if(this->empty() || maxCount == 0) {
+			return 0;
+		}
+
+		// Once detached, the events are not coalesced any more, a new event with the same key is queued behind.
+		Node * first = nullptr;
+		std::size_t count = 0;
+		{
+			std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+			first = headNode;
+			Node * last = nullptr;
+			while(count < maxCount && headNode != nullptr) {
+				last = headNode;
+				keyMap.erase(doGetKey(last->get()));
+				headNode = headNode->next;
+				++count;
+			}
+			if(last != nullptr) {
+				last->next = nullptr;
+			}
+			if(headNode == nullptr) {
+				tailNode = nullptr;
+			}
+			this->queuedCount.fetch_sub(count, std::memory_order_release);
+		}
+
+		this->doDispatchNodes(std::forward<F>(func), first);
+
+		return count;
+	}
+
+	bool peek(T * item) const
+	{
+		if(this->empty()) {
+			return false;
+		}
+
+		std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+		if(headNode == nullptr) {
+			return false;
+		}
+		*item = headNode->get();
+		return true;
+	}
+
+private:
+	static Key doGetKey(const T & item)
+	{
+		return doGetKey(item, typename internal_::MakeIndexSequence<std::tuple_size<QueuedEvent>::value>::Type());
+	}
+
+	template <size_t ...Indexes>
+	static Key doGetKey(const QueuedEvent & item, internal_::IndexSequence<Indexes...>)
+	{
+		return SelectKey::getCoalescingKey(std::get<Indexes>(item)...);
+	}
+
+private:
+	Node * headNode;
+	Node * tailNode;
+	Map keyMap;
+	std::size_t coalescedCount;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,297 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LATENCYQUEUELIST_H_284619057336
+#define LATENCYQUEUELIST_H_284619057336
+
+#include "../eventqueue.h"
+#include "../latencyhistogram.h"
+
+#include <tuple>
+#include <iterator>
+#include <chrono>
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// The queued event with the time it's enqueued.
+// It's derived from the QueuedEvent tuple, so std::get and the policy functions work on it as on the tuple.
+template <typename T>
+struct TimestampedQueuedEvent : public T
+{
+	using QueuedEvent = T;
+	using Clock = std::chrono::steady_clock;
+
+	template <typename ...A, typename = typename std::enable_if<
+		sizeof...(A) != 1
+			|| ! std::is_same<typename std::decay<typename std::tuple_element<0, std::tuple<A..., void> >::type>::type, TimestampedQueuedEvent>::value
+	>::type>
+	TimestampedQueuedEvent(A && ...args)
+		: T(std::forward<A>(args)...), enqueueTime(Clock::now())
+	{
+	}
+
+	TimestampedQueuedEvent(const TimestampedQueuedEvent &) = default;
+	TimestampedQueuedEvent(TimestampedQueuedEvent &&) = default;
+	TimestampedQueuedEvent & operator = (const TimestampedQueuedEvent &) = default;
+	TimestampedQueuedEvent & operator = (TimestampedQueuedEvent &&) = default;
+
+	Clock::time_point enqueueTime;
+};
+
+template <typename T>
+struct HasFunctionSize
+{
+	template <typename C> static std::true_type test(decltype(std::declval<const C &>().size()) *);
+	template <typename C> static std::false_type test(...);
+
+	enum { value = !! decltype(test<T>(0))() };
+};
+
+} //namespace internal_
+
+// Wraps another queue list, and measures how long each event stays in the queue, from it's enqueued
+// to it's taken by process() or takeEvent(). The residency time is recorded into a LatencyHistogram in nanoseconds.
+// It also tracks the queue depth, its high-water mark, and the dispatch rate.
+// Without the adaptor there is no overhead. With it, each event costs two clock reads and a few relaxed atomic operations.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::LatencyQueueList<>::QueueList<Item, P>; };
+// Or wrap another queue list: eventpp::LatencyQueueList<eventpp::MpscQueueList>::QueueList<Item, P>
+template <template <typename, typename> class InnerQueueList = ListQueueList>
+struct LatencyQueueList
+{
+	template <typename T, typename Policies>
+	class QueueList
+	{
+	private:
+		using Item = internal_::TimestampedQueuedEvent<T>;
+		using Inner = InnerQueueList<Item, Policies>;
+		// If the inner queue list has size(), the depth is taken from it, so it's correct even if the inner queue list
+		// replaces or destroys the queued events, such as CoalescingQueueList or RingOverflow::overwriteOldest.
+		// Otherwise the depth is counted when the events are enqueued and consumed.
+		using InnerHasSize = std::integral_constant<bool, internal_::HasFunctionSize<Inner>::value>;
+
+	public:
+		using Clock = std::chrono::steady_clock;
+		using ResidencyHistogram = LatencyHistogram<>;
+
+	public:
+		QueueList()
+			:
+				innerQueueList(),
+				residencyHistogram(),
+				queuedCount(0),
+				maxQueuedCount(0),
+				dispatchedCount(0),
+				rateStartTime(Clock::now().time_since_epoch().count())
+		{
+		}
+
+		QueueList(QueueList &&) = delete;
+		QueueList(const QueueList &) = delete;
+		QueueList & operator = (const QueueList &) = delete;
+
+		bool empty() const {
+			return innerQueueList.empty();
+		}
+
+		// The count is increased before the event is queued, so it never goes below the count of the queued events.
+		template <typename ...A>
+		bool emplace(A && ...args)
+		{
+			doBeginEnqueue(1, InnerHasSize());
+			const bool queued = innerQueueList.emplace(std::forward<A>(args)...);
+			doEndEnqueue(1, queued ? 1 : 0, InnerHasSize());
+			return queued;
+		}
+
+		template <typename ...A>
+		bool tryEmplace(A && ...args)
+		{
+			doBeginEnqueue(1, InnerHasSize());
+			const bool queued = innerQueueList.tryEmplace(std::forward<A>(args)...);
+			doEndEnqueue(1, queued ? 1 : 0, InnerHasSize());
+			return queued;
+		}
+
+		// Only available if the inner queue list has emplaceRange.
+		template <typename Iterator, typename I = Inner>
+		auto emplaceRange(Iterator first, Iterator last)
+			-> decltype(std::declval<I &>().emplaceRange(first, last))
+		{
+			const std::size_t rangeSize = (std::size_t)std::distance(first, last);
+			doBeginEnqueue(rangeSize, InnerHasSize());
+			const std::size_t count = innerQueueList.emplaceRange(first, last);
+			doEndEnqueue(rangeSize, count, InnerHasSize());
+			return count;
+		}
+
+		template <typename F>
+		std::size_t consume(F && func, const std::size_t maxCount)
+		{
+			const std::size_t count = innerQueueList.consume([this, &func](Item & item) {
+				residencyHistogram.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+					Clock::now() - item.enqueueTime
+				).count());
+				func(static_cast<T &>(item));
+			}, maxCount);
+
+			if(count > 0) {
+				doEndConsume(count, InnerHasSize());
+				dispatchedCount.fetch_add(count, std::memory_order_relaxed);
+			}
+			return count;
+		}
+
+		bool peek(T * item) const
+		{
+			Item peekedItem(*item);
+			if(! innerQueueList.peek(&peekedItem)) {
+				return false;
+			}
+			*item = static_cast<T &>(peekedItem);
+			return true;
+		}
+
+		// The histogram of the time between enqueuing and dispatching, in nanoseconds.
+		const ResidencyHistogram & getResidencyHistogram() const {
+			return residencyHistogram;
+		}
+
+		// The count of the events in the queue. It's the size() of the inner queue list if it has one,
+		// otherwise it includes the events being enqueued.
+		std::size_t getQueuedCount() const {
+			return doGetQueuedCount(InnerHasSize());
+		}
+
+		// The high-water mark of getQueuedCount() since the last resetStatistics().
+		std::size_t getMaxQueuedCount() const {
+			return maxQueuedCount.load(std::memory_order_relaxed);
+		}
+
+		// The count of the events taken from the queue since the last resetStatistics().
+		uint64_t getDispatchedCount() const {
+			return dispatchedCount.load(std::memory_order_relaxed);
+		}
+
+		// The events taken from the queue per second since the last resetStatistics().
+		double getDispatchRate() const
+		{
+			const Clock::duration elapsed = Clock::now().time_since_epoch()
+				- Clock::duration(rateStartTime.load(std::memory_order_relaxed));
+			const double seconds = std::chrono::duration_cast<std::chrono::duration<double> >(elapsed).count();
+			return seconds > 0 ? (double)getDispatchedCount() / seconds : 0.0;
+		}
+
+		// Clear the histogram, the dispatched count and the high-water mark.
+		// Not atomic with regard to concurrent enqueuing and dispatching.
+		void resetStatistics()
+		{
+			residencyHistogram.reset();
+			dispatchedCount.store(0, std::memory_order_relaxed);
+			maxQueuedCount.store(getQueuedCount(), std::memory_order_relaxed);
+			rateStartTime.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+		}
+
+		// Access the wrapped queue list, for the functions specific to the queue list type.
+		Inner & getInnerQueueList() {
+			return innerQueueList;
+		}
+
+		const Inner & getInnerQueueList() const {
+			return innerQueueList;
+		}
+
+	private:
+		void doBeginEnqueue(const std::size_t count, std::false_type)
+		{
+			doUpdateMaxQueuedCount(queuedCount.fetch_add(count, std::memory_order_relaxed) + count);
+		}
+
+		void doBeginEnqueue(const std::size_t /*count*/, std::true_type)
+		{
+		}
+
+		void doEndEnqueue(const std::size_t count, const std::size_t queuedEventCount, std::false_type)
+		{
+			if(queuedEventCount != count) {
+				queuedCount.fetch_sub(count - queuedEventCount, std::memory_order_relaxed);
+			}
+		}
+
+		void doEndEnqueue(const std::size_t /*count*/, const std::size_t queuedEventCount, std::true_type)
+		{
+			if(queuedEventCount > 0) {
+				doUpdateMaxQueuedCount(innerQueueList.size());
+			}
+		}
+
+		void doEndConsume(const std::size_t count, std::false_type)
+		{
+			queuedCount.fetch_sub(count, std::memory_order_relaxed);
+		}
+
+		void doEndConsume(const std::size_t /*count*/, std::true_type)
+		{
+		}
+
+		std::size_t doGetQueuedCount(std::false_type) const {
+			return queuedCount.load(std::memory_order_relaxed);
+		}
+
+		std::size_t doGetQueuedCount(std::true_type) const {
+			return innerQueueList.size();
+		}
+
+		void doUpdateMaxQueuedCount(const std::size_t newCount)
+		{
+			std::size_t current = maxQueuedCount.load(std::memory_order_relaxed);
+			while(newCount > current && ! maxQueuedCount.compare_exchange_weak(current, newCount, std::memory_order_relaxed)) {
+			}
+		}
+
+	private:
+		Inner innerQueueList;
+		ResidencyHistogram residencyHistogram;
+		std::atomic<std::size_t> queuedCount;
+		std::atomic<std::size_t> maxQueuedCount;
+		std::atomic<uint64_t> dispatchedCount;
+		std::atomic<Clock::rep> rateStartTime;
+	};
+};
+
+
+} //namespace eventpp
+
+namespace std {
+
+template <typename T>
+struct tuple_size <eventpp::internal_::TimestampedQueuedEvent<T> > : public tuple_size<T>
+{
+};
+
+template <std::size_t I, typename T>
+struct tuple_element <I, eventpp::internal_::TimestampedQueuedEvent<T> > : public tuple_element<I, T>
+{
+};
+
+} //namespace std
+
+
+#endif
+
@@ -0,0 +1,362 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MPSCQUEUELIST_H_381640592817
+#define MPSCQUEUELIST_H_381640592817
+
+#include "../eventpolicies.h"
+
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+
+namespace eventpp {
+
+// A queue list based on the intrusive multiple producers single consumer queue by Dmitry Vyukov.
+// Enqueuing is lock free, it costs one atomic exchange on the tail, plus one atomic exchange
+// on the free node stack once in a while to reuse the nodes.
+// Consuming is serialized by a mutex, so process() and takeEvent() can still be called from any threads,
+// but only one thread consumes at the same time.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::MpscQueueList<Item, P>; };
+template <typename T, typename Policies>
+class MpscQueueList
+{
+private:
+	using Threading = typename internal_::SelectThreading<Policies, internal_::HasTypeThreading<Policies>::value>::Type;
+	using Mutex = typename Threading::Mutex;
+
+	struct Node
+	{
+		Node() : next(nullptr), buffer()
+		{
+		}
+
+		T & get() {
+			return *reinterpret_cast<T *>(&buffer);
+		}
+
+		typename Threading::template Atomic<Node *> next;
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type buffer;
+	};
+
+	// The nodes reused by the producers in current thread.
+	// The nodes are shared by all queue lists of the same type, and freed when the thread exits.
+	// At most maxCachedNodeCount nodes are taken from a free node stack, so a producer thread
+	// doesn't hold the nodes which the other producers and queue lists could reuse.
+	static constexpr std::size_t maxCachedNodeCount = 64;
+
+	struct NodeCache
+	{
+		NodeCache() : head(nullptr)
+		{
+		}
+
+		~NodeCache()
+		{
+			freeNodeChain(head);
+		}
+
+		Node * head;
+	};
+
+public:
+	MpscQueueList()
+		:
+			stub(),
+			head(&stub),
+			tail(&stub),
+			freeNodes(nullptr),
+			consumerMutex()
+	{
+	}
+
+	~MpscQueueList()
+	{
+		consume([](T &) {}, (std::size_t)-1);
+		freeNodeChain(freeNodes.load(std::memory_order_acquire));
+	}
+
+	MpscQueueList(MpscQueueList &&) = delete;
+	MpscQueueList(const MpscQueueList &) = delete;
+	MpscQueueList & operator = (const MpscQueueList &) = delete;
+
+	// The stub node may be pushed while a producer is pushing, then the stub is at the tail
+	// but there are nodes before it, so the emptiness is checked from the head.
+	bool empty() const {
+		return head.load(std::memory_order_acquire) == &stub && stub.next.load(std::memory_order_acquire) == nullptr;
+	}
+
+	template <typename ...A>
+	bool emplace(A && ...args)
+	{
+		Node * node = doAllocateNode();
+		new (&node->buffer) T(std::forward<A>(args)...);
+		doPush(node);
+		return true;
+	}
+
+	template <typename ...A>
+	bool tryEmplace(A && ...args)
+	{
+		return emplace(std::forward<A>(args)...);
+	}
+
+	// The nodes are chained locally and pushed with one atomic exchange.
+	template <typename Iterator>
+	std::size_t emplaceRange(Iterator first, Iterator last)
+	{
+		Node * firstNode = nullptr;
+		Node * lastNode = nullptr;
+		std::size_t count = 0;
+		for(; first != last; ++first) {
+			Node * node = doAllocateNode();
+			new (&node->buffer) T(*first);
+			node->next.store(nullptr, std::memory_order_relaxed);
+			if(lastNode == nullptr) {
+				firstNode = node;
+			}
+			else {
+				lastNode->next.store(node, std::memory_order_relaxed);
+			}
+			lastNode = node;
+			++count;
+		}
+
+		if(firstNode != nullptr) {
+			Node * prev = tail.exchange(lastNode, std::memory_order_acq_rel);
+			prev->next.store(firstNode, std::memory_order_release);
+		}
+
+		return count;
+	}
+
+	template <typename F>
+	std::size_t consume(F && func, const std::size_t maxCount)
+	{
+		if(empty() || maxCount == 0) {
+			return 0;
+		}
+
+		// Detach the nodes under the lock, and invoke func out of the lock,
+		// so func can enqueue or process the queue list again.
+		Node * first = nullptr;
+		Node * last = nullptr;
+		std::size_t count = 0;
+		{
+			std::lock_guard<Mutex> consumerLock(consumerMutex);
+
+			// Only the nodes queued before the call are consumed. If the stub is at the tail,
+			// the nodes are those before the stub.
+			Node * const end = tail.load(std::memory_order_acquire);
+			while(count < maxCount) {
+				if(end == &stub && head.load(std::memory_order_relaxed) == &stub) {
+					break;
+				}
+				Node * node = doPop();
+				if(node == nullptr) {
+					break;
+				}
+				node->next.store(nullptr, std::memory_order_relaxed);
+				if(last == nullptr) {
+					first = node;
+				}
+				else {
+					last->next.store(node, std::memory_order_relaxed);
+				}
+				last = node;
+				++count;
+				if(node == end) {
+					break;
+				}
+			}
+		}
+
+		if(first != nullptr) {
+			ConsumingGuard consumingGuard(this, first, last);
+			for(; consumingGuard.node != nullptr; consumingGuard.node = consumingGuard.node->next.load(std::memory_order_relaxed)) {
+				func(consumingGuard.node->get());
+				consumingGuard.node->get().~T();
+			}
+		}
+
+		return count;
+	}
+
+	bool peek(T * item) const
+	{
+		if(empty()) {
+			return false;
+		}
+
+		std::lock_guard<Mutex> consumerLock(consumerMutex);
+
+		Node * node = head.load(std::memory_order_relaxed);
+		if(node == &stub) {
+			if(empty()) {
+				return false;
+			}
+			node = doWaitNext(node);
+		}
+		*item = node->get();
+		return true;
+	}
+
+private:
+	// Free the detached nodes when they are consumed. If func throws, the rest of the nodes
+	// are destroyed and freed too, otherwise they would be leaked.
+	struct ConsumingGuard
+	{
+		ConsumingGuard(MpscQueueList * list, Node * first, Node * last)
+			: list(list), first(first), last(last), node(first)
+		{
+		}
+
+		~ConsumingGuard()
+		{
+			for(; node != nullptr; node = node->next.load(std::memory_order_relaxed)) {
+				node->get().~T();
+			}
+			list->doFreeNodes(first, last);
+		}
+
+		MpscQueueList * list;
+		Node * first;
+		Node * last;
+		Node * node;
+	};
+
+	void doPush(Node * node)
+	{
+		node->next.store(nullptr, std::memory_order_relaxed);
+		Node * prev = tail.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	// A producer has exchanged the tail but not linked the node yet, the window is only a few instructions.
+	Node * doWaitNext(Node * node) const
+	{
+		Node * next = node->next.load(std::memory_order_acquire);
+		while(next == nullptr) {
+			std::this_thread::yield();
+			next = node->next.load(std::memory_order_acquire);
+		}
+		return next;
+	}
+
+	// Must be called with consumerMutex locked. Return nullptr if the queue is empty.
+	Node * doPop()
+	{
+		Node * node = head.load(std::memory_order_relaxed);
+		if(node == &stub) {
+			Node * next = stub.next.load(std::memory_order_acquire);
+			if(next == nullptr) {
+				if(tail.load(std::memory_order_acquire) == &stub) {
+					return nullptr;
+				}
+				next = doWaitNext(node);
+			}
+			node = next;
+			head.store(node, std::memory_order_release);
+		}
+
+		Node * next = node->next.load(std::memory_order_acquire);
+		if(next == nullptr) {
+			// node may be the last one, push the stub after it so node can be detached.
+			// A producer may push between the tail check and pushing the stub, then the stub
+			// is linked after the producer's node, and node->next is the producer's node.
+			if(tail.load(std::memory_order_acquire) == node) {
+				doPush(&stub);
+			}
+			next = doWaitNext(node);
+		}
+		head.store(next, std::memory_order_release);
+		return node;
+	}
+
+	Node * doAllocateNode()
+	{
+		NodeCache & cache = getNodeCache();
+		if(cache.head == nullptr) {
+			// Take all free nodes at once. The whole stack is exchanged, so there is no ABA problem.
+			cache.head = freeNodes.exchange(nullptr, std::memory_order_acquire);
+			if(cache.head == nullptr) {
+				return new Node();
+			}
+
+			Node * last = cache.head;
+			for(std::size_t count = 1; count < maxCachedNodeCount; ++count) {
+				Node * next = last->next.load(std::memory_order_relaxed);
+				if(next == nullptr) {
+					break;
+				}
+				last = next;
+			}
+			Node * rest = last->next.load(std::memory_order_relaxed);
+			if(rest != nullptr) {
+				last->next.store(nullptr, std::memory_order_relaxed);
+				// Give the rest back with one exchange, then push the nodes freed meanwhile on top of it.
+				// They are freed by the consumer in the short window, so walking them is cheap.
+				Node * freed = freeNodes.exchange(rest, std::memory_order_acq_rel);
+				if(freed != nullptr) {
+					Node * freedLast = freed;
+					for(Node * next = freedLast->next.load(std::memory_order_relaxed); next != nullptr; next = next->next.load(std::memory_order_relaxed)) {
+						freedLast = next;
+					}
+					doFreeNodes(freed, freedLast);
+				}
+			}
+		}
+
+		Node * node = cache.head;
+		cache.head = node->next.load(std::memory_order_relaxed);
+		return node;
+	}
+
+	void doFreeNodes(Node * first, Node * last)
+	{
+		Node * top = freeNodes.load(std::memory_order_relaxed);
+		do {
+			last->next.store(top, std::memory_order_relaxed);
+		} while(! freeNodes.compare_exchange_weak(top, first, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	static void freeNodeChain(Node * node)
+	{
+		while(node != nullptr) {
+			Node * next = node->next.load(std::memory_order_relaxed);
+			delete node;
+			node = next;
+		}
+	}
+
+	static NodeCache & getNodeCache() {
+		static thread_local NodeCache nodeCache;
+		return nodeCache;
+	}
+
+private:
+	mutable Node stub;
+	typename Threading::template Atomic<Node *> head;
+	typename Threading::template Atomic<Node *> tail;
+	typename Threading::template Atomic<Node *> freeNodes;
+	mutable Mutex consumerMutex;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,168 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NODEQUEUELISTBASE_H_572048163920
+#define NODEQUEUELISTBASE_H_572048163920
+
+#include "../eventpolicies.h"
+
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+namespace eventpp {
+
+namespace internal_ {
+
+// The nodes and the free node stack shared by the node based queue lists, such as PriorityQueueList
+// and CoalescingQueueList. The items are constructed out of the lock, and dispatched out of the lock.
+template <typename T, typename Policies>
+class NodeQueueListBase
+{
+protected:
+	using Threading = typename SelectThreading<Policies, HasTypeThreading<Policies>::value>::Type;
+	using Mutex = typename Threading::Mutex;
+
+	struct Node
+	{
+		Node() : buffer(), next(nullptr)
+		{
+		}
+
+		T & get() {
+			return *reinterpret_cast<T *>(&buffer);
+		}
+
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type buffer;
+		Node * next;
+	};
+
+public:
+	NodeQueueListBase()
+		:
+			queuedCount(0),
+			queueMutex(),
+			freeNode(nullptr),
+			freeMutex()
+	{
+	}
+
+	~NodeQueueListBase()
+	{
+		while(freeNode != nullptr) {
+			Node * next = freeNode->next;
+			delete freeNode;
+			freeNode = next;
+		}
+	}
+
+	NodeQueueListBase(NodeQueueListBase &&) = delete;
+	NodeQueueListBase(const NodeQueueListBase &) = delete;
+	NodeQueueListBase & operator = (const NodeQueueListBase &) = delete;
+
+	bool empty() const {
+		return queuedCount.load(std::memory_order_acquire) == 0;
+	}
+
+protected:
+	template <typename ...A>
+	Node * doCreateNode(A && ...args)
+	{
+		Node * node = nullptr;
+		if(freeNode != nullptr) {
+			std::lock_guard<Mutex> lockGuard(freeMutex);
+			if(freeNode != nullptr) {
+				node = freeNode;
+				freeNode = node->next;
+			}
+		}
+		if(node == nullptr) {
+			node = new Node();
+		}
+
+		new (&node->buffer) T(std::forward<A>(args)...);
+		node->next = nullptr;
+		return node;
+	}
+
+	// Invoke func on the chain of detached nodes, then free the nodes.
+	// The nodes are freed in a guard, so they are not leaked if func throws.
+	template <typename F>
+	void doDispatchNodes(F && func, Node * first)
+	{
+		FreeNodesGuard freeNodesGuard(this, first);
+		for(Node * node = first; node != nullptr; node = node->next) {
+			func(node->get());
+		}
+	}
+
+	// Destroy the items in the chain and put the nodes to the free stack.
+	void doFreeNodes(Node * first)
+	{
+		Node * last = nullptr;
+		for(Node * node = first; node != nullptr; node = node->next) {
+			node->get().~T();
+			last = node;
+		}
+
+		if(last != nullptr) {
+			std::lock_guard<Mutex> lockGuard(freeMutex);
+			last->next = freeNode;
+			freeNode = first;
+		}
+	}
+
+	static void doDestroyNodes(Node * node)
+	{
+		while(node != nullptr) {
+			Node * next = node->next;
+			node->get().~T();
+			delete node;
+			node = next;
+		}
+	}
+
+private:
+	struct FreeNodesGuard
+	{
+		FreeNodesGuard(NodeQueueListBase * list, Node * first)
+			: list(list), first(first)
+		{
+		}
+
+		~FreeNodesGuard()
+		{
+			list->doFreeNodes(first);
+		}
+
+		NodeQueueListBase * list;
+		Node * first;
+	};
+
+protected:
+	typename Threading::template Atomic<std::size_t> queuedCount;
+	mutable Mutex queueMutex;
+
+private:
+	Node * freeNode;
+	Mutex freeMutex;
+};
+
+} //namespace internal_
+
+
+} //namespace eventpp
+
+
+#endif
@@ -0,0 +1,331 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PRIORITYQUEUELIST_H_204957381642
+#define PRIORITYQUEUELIST_H_204957381642
+
+#include "../eventpolicies.h"
+#include "nodequeuelistbase.h"
+
+#include <vector>
+#include <array>
+#include <tuple>
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace eventpp {
+
+namespace internal_ {
+
+template <typename Policies, typename QueuedEvent>
+struct PriorityOf;
+
+template <typename Policies, typename Event, typename ...Args>
+struct PriorityOf <Policies, std::tuple<Event, Args...> >
+{
+	using Type = typename std::decay<
+		decltype(Policies::getPriority(std::declval<const Event &>(), std::declval<const Args &>()...))
+	>::type;
+};
+
+} //namespace internal_
+
+// The events are dispatched from the highest priority to the lowest, and in FIFO order within the same priority.
+// The priority is returned by the policy function getPriority(const Event & e, const Args & ...args),
+// it can be any type which supports operator <.
+// The queued events are held in a binary heap, enqueuing and dispatching cost O(log n).
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::PriorityQueueList<Item, P>; };
+template <typename T, typename Policies>
+class PriorityQueueList : public internal_::NodeQueueListBase<T, Policies>
+{
+private:
+	using super = internal_::NodeQueueListBase<T, Policies>;
+	using Node = typename super::Node;
+	using Mutex = typename super::Mutex;
+
+public:
+	using Priority = typename internal_::PriorityOf<Policies, typename internal_::UnwrapQueuedEvent<T>::Type>::Type;
+
+private:
+	struct Entry
+	{
+		Priority priority;
+		uint64_t sequence;
+		Node * node;
+	};
+
+	// The heap top is the entry with the highest priority and the smallest sequence.
+	struct EntryLess
+	{
+		bool operator() (const Entry & a, const Entry & b) const {
+			if(a.priority < b.priority) {
+				return true;
+			}
+			if(b.priority < a.priority) {
+				return false;
+			}
+			return a.sequence > b.sequence;
+		}
+	};
+
+public:
+	PriorityQueueList()
+		:
+			super(),
+			entryList(),
+			nextSequence(0)
+	{
+	}
+
+	~PriorityQueueList()
+	{
+		for(auto & entry : entryList) {
+			entry.node->next = nullptr;
+			super::doDestroyNodes(entry.node);
+		}
+	}
+
+	template <typename ...A>
+	bool emplace(A && ...args)
+	{
+		Priority priority = Policies::getPriority(args...);
+		Node * node = this->doCreateNode(std::forward<A>(args)...);
+
+		std::lock_guard<Mutex> lockGuard(this->queueMutex);
+		entryList.push_back(Entry { std::move(priority), nextSequence++, node });
+		std::push_heap(entryList.begin(), entryList.end(), EntryLess());
+		this->queuedCount.fetch_add(1, std::memory_order_release);
+
+		return true;
+	}
+
+	template <typename ...A>
+	bool tryEmplace(A && ...args)
+	{
+		return emplace(std::forward<A>(args)...);
+	}
+
+	template <typename F>
+	std::size_t consume(F && func, const std::size_t maxCount)
+	{
+		if(this->empty() || maxCount == 0) {
+			return 0;
+		}
+
+		Node * first = nullptr;
+		Node * last = nullptr;
+		std::size_t count = 0;
+		{
+			std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+			while(count < maxCount && ! entryList.empty()) {
+				std::pop_heap(entryList.begin(), entryList.end(), EntryLess());
+				Node * node = entryList.back().node;
+				entryList.pop_back();
+				if(last == nullptr) {
+					first = node;
+				}
+				else {
+					last->next = node;
+				}
+				last = node;
+				++count;
+			}
+			this->queuedCount.fetch_sub(count, std::memory_order_release);
+		}
+
+		this->doDispatchNodes(std::forward<F>(func), first);
+
+		return count;
+	}
+
+	bool peek(T * item) const
+	{
+		if(this->empty()) {
+			return false;
+		}
+
+		std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+		if(entryList.empty()) {
+			return false;
+		}
+		*item = entryList.front().node->get();
+		return true;
+	}
+
+private:
+	std::vector<Entry> entryList;
+	uint64_t nextSequence;
+};
+
+// Same as PriorityQueueList, but the priority is an integer in [0, LaneCount), larger value is higher priority.
+// Out of range priorities are clamped. Each priority has its own FIFO lane, enqueuing and dispatching cost O(1).
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::LanePriorityQueueList<4>::QueueList<Item, P>; };
+template <std::size_t LaneCount>
+struct LanePriorityQueueList
+{
+	static_assert(LaneCount > 0, "LanePriorityQueueList LaneCount must be greater than 0.");
+
+	template <typename T, typename Policies>
+	class QueueList : public internal_::NodeQueueListBase<T, Policies>
+	{
+	private:
+		using super = internal_::NodeQueueListBase<T, Policies>;
+		using Node = typename super::Node;
+		using Mutex = typename super::Mutex;
+
+		struct Lane
+		{
+			Node * head;
+			Node * tail;
+		};
+
+	public:
+		QueueList()
+			:
+				super(),
+				laneList()
+		{
+			for(auto & lane : laneList) {
+				lane.head = nullptr;
+				lane.tail = nullptr;
+			}
+		}
+
+		~QueueList()
+		{
+			for(auto & lane : laneList) {
+				super::doDestroyNodes(lane.head);
+			}
+		}
+
+		template <typename ...A>
+		bool emplace(A && ...args)
+		{
+			const std::size_t laneIndex = getLaneIndex(Policies::getPriority(args...));
+			Node * node = this->doCreateNode(std::forward<A>(args)...);
+
+			std::lock_guard<Mutex> lockGuard(this->queueMutex);
+			Lane & lane = laneList[laneIndex];
+			if(lane.tail == nullptr) {
+				lane.head = node;
+			}
+			else {
+				lane.tail->next = node;
+			}
+			lane.tail = node;
+			this->queuedCount.fetch_add(1, std::memory_order_release);
+
+			return true;
+		}
+
+		template <typename ...A>
+		bool tryEmplace(A && ...args)
+		{
+			return emplace(std::forward<A>(args)...);
+		}
+
+		template <typename F>
+		std::size_t consume(F && func, const std::size_t maxCount)
+		{
+			if(this->empty() || maxCount == 0) {
+				return 0;
+			}
+
+			Node * first = nullptr;
+			Node * last = nullptr;
+			std::size_t count = 0;
+			{
+				std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+				for(std::size_t i = LaneCount; i > 0 && count < maxCount; --i) {
+					Lane & lane = laneList[i - 1];
+					if(lane.head == nullptr) {
+						continue;
+					}
+
+					// Detach the front of the lane, the whole lane if possible.
+					Node * laneFirst = lane.head;
+					Node * laneLast = lane.head;
+					++count;
+					while(count < maxCount && laneLast->next != nullptr) {
+						laneLast = laneLast->next;
+						++count;
+					}
+					lane.head = laneLast->next;
+					if(lane.head == nullptr) {
+						lane.tail = nullptr;
+					}
+					laneLast->next = nullptr;
+
+					if(last == nullptr) {
+						first = laneFirst;
+					}
+					else {
+						last->next = laneFirst;
+					}
+					last = laneLast;
+				}
+				this->queuedCount.fetch_sub(count, std::memory_order_release);
+			}
+
+			this->doDispatchNodes(std::forward<F>(func), first);
+
+			return count;
+		}
+
+		bool peek(T * item) const
+		{
+			if(this->empty()) {
+				return false;
+			}
+
+			std::lock_guard<Mutex> lockGuard(this->queueMutex);
+
+			for(std::size_t i = LaneCount; i > 0; --i) {
+				if(laneList[i - 1].head != nullptr) {
+					*item = laneList[i - 1].head->get();
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		template <typename P>
+		static std::size_t getLaneIndex(const P priority) {
+			if(priority <= P(0)) {
+				return 0;
+			}
+			if((typename std::make_unsigned<P>::type)priority >= LaneCount) {
+				return LaneCount - 1;
+			}
+			return (std::size_t)priority;
+		}
+
+	private:
+		std::array<Lane, LaneCount> laneList;
+	};
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
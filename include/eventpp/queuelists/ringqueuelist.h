@@ -0,0 +1,355 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RINGQUEUELIST_H_530472918364
+#define RINGQUEUELIST_H_530472918364
+
+#include "../eventpolicies.h"
+
+#include <vector>
+#include <mutex>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+namespace eventpp {
+
+// What a RingQueueList does when an event is enqueued and the ring is full.
+enum class RingOverflow
+{
+	// Block the producer until there is free slot. tryEnqueue returns false instead of blocking.
+	// If the producer is a listener dispatched by this queue list, it would never be woken up,
+	// so the event is not queued and counted as dropped instead.
+	block,
+	// The event is not queued, the enqueue is counted as dropped.
+	// tryEnqueue returns false and the enqueue is not counted.
+	fail,
+	// Same as fail, except that tryEnqueue is also counted as dropped.
+	dropNewest,
+	// Destroy the oldest queued event to make room, it's counted as overwritten.
+	// If the oldest slot is being dispatched, the new event is dropped instead.
+	overwriteOldest
+};
+
+// A bounded queue list. All slots are allocated in the constructor, there is no allocation after that.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::RingQueueList<1024>::QueueList<Item, P>; };
+template <std::size_t Capacity, RingOverflow Overflow = RingOverflow::block>
+struct RingQueueList
+{
+	static_assert(Capacity > 0, "RingQueueList Capacity must be greater than 0.");
+
+	template <typename T, typename Policies>
+	class QueueList
+	{
+	private:
+		using Threading = typename internal_::SelectThreading<Policies, internal_::HasTypeThreading<Policies>::value>::Type;
+		using Mutex = typename Threading::Mutex;
+		using ConditionVariable = typename Threading::ConditionVariable;
+
+		using Slot = typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type;
+
+		using IsBlocking = std::integral_constant<bool, Overflow == RingOverflow::block>;
+
+		enum class SlotState : uint8_t
+		{
+			free,
+			queued,
+			dispatching,
+			dispatched
+		};
+
+		// The consume calls running in the current thread, so a re-entrant emplace is detected.
+		struct ConsumingGuard
+		{
+			explicit ConsumingGuard(const QueueList * list)
+				: list(list), previous(getConsumingHead())
+			{
+				getConsumingHead() = this;
+			}
+
+			~ConsumingGuard()
+			{
+				getConsumingHead() = previous;
+			}
+
+			const QueueList * list;
+			ConsumingGuard * previous;
+		};
+
+	public:
+		QueueList()
+			:
+				slotList(Capacity),
+				slotStateList(Capacity, SlotState::free),
+				freeIndex(0),
+				readIndex(0),
+				writeIndex(0),
+				queuedCount(0),
+				droppedCount(0),
+				overwrittenCount(0),
+				mutex(),
+				slotFreedConditionVariable()
+		{
+		}
+
+		~QueueList()
+		{
+			for(std::size_t i = readIndex; i != writeIndex; ++i) {
+				getItem(i).~T();
+			}
+		}
+
+		QueueList(QueueList &&) = delete;
+		QueueList(const QueueList &) = delete;
+		QueueList & operator = (const QueueList &) = delete;
+
+		bool empty() const {
+			return queuedCount.load(std::memory_order_acquire) == 0;
+		}
+
+		template <typename ...A>
+		bool emplace(A && ...args)
+		{
+			return doEmplace(
+				Overflow == RingOverflow::block,
+				Overflow == RingOverflow::overwriteOldest,
+				true,
+				std::forward<A>(args)...
+			);
+		}
+
+		// Never blocks.
+		template <typename ...A>
+		bool tryEmplace(A && ...args)
+		{
+			return doEmplace(
+				false,
+				Overflow == RingOverflow::overwriteOldest,
+				Overflow == RingOverflow::dropNewest || Overflow == RingOverflow::overwriteOldest,
+				std::forward<A>(args)...
+			);
+		}
+
+		template <typename F>
+		std::size_t consume(F && func, const std::size_t maxCount)
+		{
+			if(empty() || maxCount == 0) {
+				return 0;
+			}
+
+			// Mark the slots as dispatching, they are neither visible to other consumers
+			// nor reused by the producers until they are dispatched.
+			std::size_t begin;
+			std::size_t end;
+			{
+				std::lock_guard<Mutex> lockGuard(mutex);
+
+				begin = readIndex;
+				end = writeIndex;
+				if(end - begin > maxCount) {
+					end = begin + maxCount;
+				}
+				for(std::size_t i = begin; i != end; ++i) {
+					slotStateList[i % Capacity] = SlotState::dispatching;
+				}
+				readIndex = end;
+				queuedCount.fetch_sub(end - begin, std::memory_order_release);
+			}
+
+			if(begin == end) {
+				return 0;
+			}
+
+			{
+				ConsumingGuard consumingGuard(this);
+				DispatchingGuard dispatchingGuard(this, begin, end);
+				for(; dispatchingGuard.next != end; ++dispatchingGuard.next) {
+					T & item = getItem(dispatchingGuard.next);
+					func(item);
+					item.~T();
+				}
+			}
+
+			return end - begin;
+		}
+
+		bool peek(T * item) const
+		{
+			if(empty()) {
+				return false;
+			}
+
+			std::lock_guard<Mutex> lockGuard(mutex);
+
+			if(readIndex == writeIndex) {
+				return false;
+			}
+			*item = const_cast<QueueList *>(this)->getItem(readIndex);
+			return true;
+		}
+
+		static constexpr std::size_t getCapacity() {
+			return Capacity;
+		}
+
+		// The count of the queued events, not including the events being dispatched.
+		std::size_t size() const {
+			return queuedCount.load(std::memory_order_acquire);
+		}
+
+		// The count of the events that are not queued because the ring is full.
+		uint64_t getDroppedCount() const {
+			return droppedCount.load(std::memory_order_relaxed);
+		}
+
+		// The count of the queued events that are destroyed by RingOverflow::overwriteOldest.
+		uint64_t getOverwrittenCount() const {
+			return overwrittenCount.load(std::memory_order_relaxed);
+		}
+
+	private:
+		template <typename ...A>
+		bool doEmplace(const bool canBlock, const bool canOverwrite, const bool countDropped, A && ...args)
+		{
+			std::unique_lock<Mutex> lock(mutex);
+
+			if(writeIndex - freeIndex == Capacity) {
+				if(canBlock && ! isConsumingInThisThread()) {
+					doWaitForFreeSlot(lock, IsBlocking());
+				}
+				else if(canOverwrite && freeIndex == readIndex) {
+					getItem(readIndex).~T();
+					slotStateList[readIndex % Capacity] = SlotState::free;
+					++readIndex;
+					++freeIndex;
+					queuedCount.fetch_sub(1, std::memory_order_release);
+					overwrittenCount.fetch_add(1, std::memory_order_relaxed);
+				}
+				else {
+					if(countDropped || canBlock) {
+						droppedCount.fetch_add(1, std::memory_order_relaxed);
+					}
+					return false;
+				}
+			}
+
+			new (&slotList[writeIndex % Capacity]) T(std::forward<A>(args)...);
+			slotStateList[writeIndex % Capacity] = SlotState::queued;
+			++writeIndex;
+			queuedCount.fetch_add(1, std::memory_order_release);
+
+			return true;
+		}
+
+		bool isConsumingInThisThread() const {
+			for(const ConsumingGuard * guard = getConsumingHead(); guard != nullptr; guard = guard->previous) {
+				if(guard->list == this) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static ConsumingGuard *& getConsumingHead() {
+			static thread_local ConsumingGuard * head = nullptr;
+			return head;
+		}
+
+		// Free the dispatched slots when the batch is done. If func throws, the rest of the batch is destroyed
+		// and freed too, otherwise the slots would stay dispatching and the capacity would be lost.
+		struct DispatchingGuard
+		{
+			DispatchingGuard(QueueList * list, const std::size_t begin, const std::size_t end)
+				: list(list), begin(begin), end(end), next(begin)
+			{
+			}
+
+			~DispatchingGuard()
+			{
+				for(; next != end; ++next) {
+					list->getItem(next).~T();
+				}
+				list->doFreeSlots(begin, end);
+			}
+
+			QueueList * list;
+			std::size_t begin;
+			std::size_t end;
+			std::size_t next;
+		};
+
+		void doFreeSlots(const std::size_t begin, const std::size_t end)
+		{
+			{
+				std::lock_guard<Mutex> lockGuard(mutex);
+
+				for(std::size_t i = begin; i != end; ++i) {
+					slotStateList[i % Capacity] = SlotState::dispatched;
+				}
+				// The slots are freed in order, the slots dispatched by another consumer may be freed here.
+				while(freeIndex != readIndex && slotStateList[freeIndex % Capacity] == SlotState::dispatched) {
+					slotStateList[freeIndex % Capacity] = SlotState::free;
+					++freeIndex;
+				}
+			}
+			doNotifySlotFreed(IsBlocking());
+		}
+
+		// Only RingOverflow::block waits on the condition variable, so the other modes
+		// also work with a Threading which mutex can't be waited on, such as SingleThreading.
+		void doWaitForFreeSlot(std::unique_lock<Mutex> & lock, std::true_type)
+		{
+			slotFreedConditionVariable.wait(lock, [this]() -> bool {
+				return writeIndex - freeIndex < Capacity;
+			});
+		}
+
+		void doWaitForFreeSlot(std::unique_lock<Mutex> & /*lock*/, std::false_type)
+		{
+		}
+
+		void doNotifySlotFreed(std::true_type)
+		{
+			slotFreedConditionVariable.notify_all();
+		}
+
+		void doNotifySlotFreed(std::false_type)
+		{
+		}
+
+		T & getItem(const std::size_t index) {
+			return *reinterpret_cast<T *>(&slotList[index % Capacity]);
+		}
+
+	private:
+		std::vector<Slot> slotList;
+		std::vector<SlotState> slotStateList;
+		// The indexes increase monotonically, freeIndex <= readIndex <= writeIndex.
+		// [freeIndex, readIndex) are being dispatched, [readIndex, writeIndex) are queued.
+		std::size_t freeIndex;
+		std::size_t readIndex;
+		std::size_t writeIndex;
+		typename Threading::template Atomic<std::size_t> queuedCount;
+		typename Threading::template Atomic<uint64_t> droppedCount;
+		typename Threading::template Atomic<uint64_t> overwrittenCount;
+		mutable Mutex mutex;
+		ConditionVariable slotFreedConditionVariable;
+	};
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,169 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SPSCQUEUELIST_H_815302946721
+#define SPSCQUEUELIST_H_815302946721
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <cstddef>
+
+namespace eventpp {
+
+// A lock free bounded ring for single producer and single consumer. There is no mutex.
+// Only one thread can enqueue, and only one thread can process, peek or take the events.
+// The listeners must not enqueue unless the consumer thread is the only producer.
+// The indexes are on separate cache lines. The producer keeps a cached copy of the read index and only reloads it
+// when the ring looks full, the consumer loads the write index once for each batch.
+// When the ring is full, enqueue spins until there is a free slot, so it's not wait free.
+// tryEnqueue returns false instead, it and the consumer functions are wait free.
+// Usage: struct Policies { template <typename Item, typename P> using QueueList = eventpp::SpscQueueList<1024>::QueueList<Item, P>; };
+template <std::size_t Capacity>
+struct SpscQueueList
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueueList Capacity must be a power of 2.");
+
+	template <typename T, typename Policies>
+	class QueueList
+	{
+	private:
+		using Slot = typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type;
+
+		enum : std::size_t {
+			cacheLineSize = 64,
+			indexMask = Capacity - 1
+		};
+
+	public:
+		QueueList()
+			:
+				slotList(new Slot[Capacity]),
+				writeIndex(0),
+				cachedReadIndex(0),
+				readIndex(0)
+		{
+		}
+
+		~QueueList()
+		{
+			consume([](T &) {}, Capacity);
+		}
+
+		QueueList(QueueList &&) = delete;
+		QueueList(const QueueList &) = delete;
+		QueueList & operator = (const QueueList &) = delete;
+
+		bool empty() const {
+			return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+		}
+
+		template <typename ...A>
+		bool emplace(A && ...args)
+		{
+			const std::size_t index = writeIndex.load(std::memory_order_relaxed);
+			while(! doHasRoom(index)) {
+				std::this_thread::yield();
+			}
+			doEmplace(index, std::forward<A>(args)...);
+			return true;
+		}
+
+		template <typename ...A>
+		bool tryEmplace(A && ...args)
+		{
+			const std::size_t index = writeIndex.load(std::memory_order_relaxed);
+			if(! doHasRoom(index)) {
+				return false;
+			}
+			doEmplace(index, std::forward<A>(args)...);
+			return true;
+		}
+
+		template <typename F>
+		std::size_t consume(F && func, const std::size_t maxCount)
+		{
+			// The write index is read once per call, and only the events queued before the call are consumed.
+			std::size_t index = readIndex.load(std::memory_order_relaxed);
+			const std::size_t available = writeIndex.load(std::memory_order_acquire) - index;
+			const std::size_t count = available < maxCount ? available : maxCount;
+			for(std::size_t i = 0; i < count; ++i) {
+				T & item = get(index);
+				func(item);
+				item.~T();
+				++index;
+				// Free the slot immediately, so the producer doesn't wait for the whole batch.
+				readIndex.store(index, std::memory_order_release);
+			}
+
+			return count;
+		}
+
+		bool peek(T * item) const
+		{
+			const std::size_t index = readIndex.load(std::memory_order_relaxed);
+			if(index == writeIndex.load(std::memory_order_acquire)) {
+				return false;
+			}
+			*item = const_cast<QueueList *>(this)->get(index);
+			return true;
+		}
+
+		std::size_t getCapacity() const {
+			return Capacity;
+		}
+
+	private:
+		T & get(const std::size_t index) {
+			return *reinterpret_cast<T *>(&slotList[index & indexMask]);
+		}
+
+		// Called by the producer.
+		bool doHasRoom(const std::size_t index)
+		{
+			if(index - cachedReadIndex < Capacity) {
+				return true;
+			}
+			cachedReadIndex = readIndex.load(std::memory_order_acquire);
+			return index - cachedReadIndex < Capacity;
+		}
+
+		template <typename ...A>
+		void doEmplace(const std::size_t index, A && ...args)
+		{
+			new (&slotList[index & indexMask]) T(std::forward<A>(args)...);
+			writeIndex.store(index + 1, std::memory_order_release);
+		}
+
+	private:
+		std::unique_ptr<Slot[]> slotList;
+
+		// Written by the producer.
+		char paddingBeforeWrite[cacheLineSize];
+		std::atomic<std::size_t> writeIndex;
+		std::size_t cachedReadIndex;
+
+		// Written by the consumer.
+		char paddingBeforeRead[cacheLineSize];
+		std::atomic<std::size_t> readIndex;
+		char paddingAfterRead[cacheLineSize];
+	};
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
@@ -0,0 +1,382 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TIMINGWHEEL_H_851930274615
+#define TIMINGWHEEL_H_851930274615
+
+#include <array>
+#include <type_traits>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+namespace eventpp {
+
+// A hierarchical timing wheel holding items of type T, each item expires at a tick.
+// There are 4 levels with 256 slots each. Adding and cancelling an item are O(1),
+// the items are moved to the lower levels when the lower level wheel wraps around.
+// The ticks are only meaningful to the caller, for example, milliseconds since a time point.
+// The class is not thread safe.
+template <typename T>
+class TimingWheel
+{
+private:
+	enum : uint64_t {
+		levelCount = 4,
+		slotBits = 8,
+		slotCount = uint64_t(1) << slotBits,
+		slotMask = slotCount - 1
+	};
+
+	struct Node;
+
+	struct NodeList
+	{
+		Node * head;
+		Node * tail;
+	};
+
+	struct Node
+	{
+		Node() : buffer(), expireTick(0), id(0), list(nullptr), previous(nullptr), next(nullptr)
+		{
+		}
+
+		T & get() {
+			return *reinterpret_cast<T *>(&buffer);
+		}
+
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type buffer;
+		uint64_t expireTick;
+		// 0 if the node is free. The id is never reused, so a stale handle can't cancel another item.
+		uint64_t id;
+		NodeList * list;
+		Node * previous;
+		Node * next;
+	};
+
+public:
+	class Handle
+	{
+	public:
+		Handle() : node(nullptr), id(0)
+		{
+		}
+
+		explicit operator bool () const {
+			return node != nullptr;
+		}
+
+	private:
+		Handle(Node * node, const uint64_t id) : node(node), id(id)
+		{
+		}
+
+	private:
+		Node * node;
+		uint64_t id;
+
+		friend class TimingWheel;
+	};
+
+public:
+	explicit TimingWheel(const uint64_t currentTick = 0)
+		:
+			levelList(),
+			dueList(),
+			expiringList(),
+			currentTick(currentTick),
+			nextId(1),
+			itemCount(0),
+			freeNode(nullptr)
+	{
+		for(auto & level : levelList) {
+			for(auto & list : level) {
+				list.head = nullptr;
+				list.tail = nullptr;
+			}
+		}
+		dueList.head = nullptr;
+		dueList.tail = nullptr;
+		expiringList.head = nullptr;
+		expiringList.tail = nullptr;
+	}
+
+	~TimingWheel()
+	{
+		for(auto & level : levelList) {
+			for(auto & list : level) {
+				doDestroyList(list);
+			}
+		}
+		doDestroyList(dueList);
+		while(freeNode != nullptr) {
+			Node * next = freeNode->next;
+			delete freeNode;
+			freeNode = next;
+		}
+	}
+
+	TimingWheel(TimingWheel &&) = delete;
+	TimingWheel(const TimingWheel &) = delete;
+	TimingWheel & operator = (const TimingWheel &) = delete;
+
+	// If expireTick is not later than the current tick, the item expires in the next advance().
+	template <typename ...A>
+	Handle add(const uint64_t expireTick, A && ...args)
+	{
+		Node * node = freeNode;
+		if(node != nullptr) {
+			freeNode = node->next;
+		}
+		else {
+			node = new Node();
+		}
+
+		new (&node->buffer) T(std::forward<A>(args)...);
+		node->expireTick = expireTick;
+		node->id = nextId++;
+		doInsert(node);
+		++itemCount;
+
+		return Handle(node, node->id);
+	}
+
+	// Return false if the item has expired or has been cancelled, or it's being expired.
+	// It can be called in the func of advance to cancel the other items expiring at the same tick.
+	bool cancel(const Handle & handle)
+	{
+		Node * node = handle.node;
+		if(node == nullptr || node->id != handle.id || node->list == nullptr) {
+			return false;
+		}
+
+		doRemoveFromList(node);
+		doFreeNode(node);
+		--itemCount;
+
+		return true;
+	}
+
+	// Advance the current tick to tick, invoke func(T &) on each expired item then destroy the item.
+	// The items expired at earlier ticks are invoked earlier.
+	template <typename F>
+	void advance(const uint64_t tick, F && func)
+	{
+		doExpireList(dueList, func);
+
+		while(currentTick < tick) {
+			// Skip the ticks without any expiring or cascading.
+			const uint64_t nextTick = getNextTick();
+			if(nextTick > tick) {
+				currentTick = tick;
+				break;
+			}
+			currentTick = nextTick;
+
+			// Cascade the higher levels when the lower level wraps around.
+			for(uint64_t level = 1; level < levelCount; ++level) {
+				if(((currentTick >> ((level - 1) * slotBits)) & slotMask) != 0) {
+					break;
+				}
+				doCascade(levelList[level][(currentTick >> (level * slotBits)) & slotMask]);
+			}
+
+			// The cascaded items expiring at current tick are put in dueList.
+			doExpireList(dueList, func);
+			doExpireList(levelList[0][currentTick & slotMask], func);
+		}
+	}
+
+	uint64_t getCurrentTick() const {
+		return currentTick;
+	}
+
+	bool empty() const {
+		return itemCount == 0;
+	}
+
+	std::size_t size() const {
+		return itemCount;
+	}
+
+	// Return the tick that advance() should be called with to expire the next items.
+	// The returned tick may be earlier than any expire tick if the wheel needs to cascade at that tick.
+	// Return the max value of uint64_t if the wheel is empty.
+	uint64_t getNextTick() const
+	{
+		if(itemCount == 0) {
+			return std::numeric_limits<uint64_t>::max();
+		}
+		if(dueList.head != nullptr) {
+			return currentTick;
+		}
+
+		// The items in level 0 expire within the next slotCount ticks.
+		uint64_t result = std::numeric_limits<uint64_t>::max();
+		for(uint64_t tick = currentTick + 1; tick <= currentTick + slotMask; ++tick) {
+			if(levelList[0][tick & slotMask].head != nullptr) {
+				result = tick;
+				break;
+			}
+		}
+
+		// The empty slots in the higher levels don't need cascading, so only the first non-empty slot matters.
+		for(uint64_t level = 1; level < levelCount; ++level) {
+			const uint64_t shift = level * slotBits;
+			for(uint64_t i = 1; i <= slotCount; ++i) {
+				const uint64_t tick = ((currentTick >> shift) + i) << shift;
+				if(tick >= result) {
+					break;
+				}
+				if(levelList[level][(tick >> shift) & slotMask].head != nullptr) {
+					result = tick;
+					break;
+				}
+			}
+		}
+
+		return result;
+	}
+
+private:
+	void doInsert(Node * node)
+	{
+		const uint64_t expireTick = node->expireTick;
+		if(expireTick <= currentTick) {
+			doAppendToList(dueList, node);
+			return;
+		}
+
+		const uint64_t delta = expireTick - currentTick;
+		for(uint64_t level = 0; level < levelCount - 1; ++level) {
+			if(delta < (uint64_t(1) << ((level + 1) * slotBits))) {
+				doAppendToList(levelList[level][(expireTick >> (level * slotBits)) & slotMask], node);
+				return;
+			}
+		}
+
+		// Too far away, put it in the farthest slot of the top level, it will be inserted again when cascaded.
+		const uint64_t maxDelta = (uint64_t(1) << (levelCount * slotBits)) - 1;
+		const uint64_t tick = delta > maxDelta ? currentTick + maxDelta : expireTick;
+		doAppendToList(levelList[levelCount - 1][(tick >> ((levelCount - 1) * slotBits)) & slotMask], node);
+	}
+
+	void doCascade(NodeList & list)
+	{
+		Node * node = list.head;
+		list.head = nullptr;
+		list.tail = nullptr;
+		while(node != nullptr) {
+			Node * next = node->next;
+			doInsert(node);
+			node = next;
+		}
+	}
+
+	// func may add items to the same list, so the list is moved to expiringList first.
+	// func may also cancel the items in expiringList, so the items are removed one by one
+	// instead of walking the next pointers.
+	template <typename F>
+	void doExpireList(NodeList & list, F & func)
+	{
+		if(list.head == nullptr) {
+			return;
+		}
+
+		expiringList = list;
+		list.head = nullptr;
+		list.tail = nullptr;
+		for(Node * node = expiringList.head; node != nullptr; node = node->next) {
+			node->list = &expiringList;
+		}
+
+		while(expiringList.head != nullptr) {
+			Node * node = expiringList.head;
+			doRemoveFromList(node);
+			--itemCount;
+			func(node->get());
+			doFreeNode(node);
+		}
+	}
+
+	static void doAppendToList(NodeList & list, Node * node)
+	{
+		node->list = &list;
+		node->previous = list.tail;
+		node->next = nullptr;
+		if(list.tail == nullptr) {
+			list.head = node;
+		}
+		else {
+			list.tail->next = node;
+		}
+		list.tail = node;
+	}
+
+	static void doRemoveFromList(Node * node)
+	{
+		NodeList & list = *node->list;
+		if(node->previous == nullptr) {
+			list.head = node->next;
+		}
+		else {
+			node->previous->next = node->next;
+		}
+		if(node->next == nullptr) {
+			list.tail = node->previous;
+		}
+		else {
+			node->next->previous = node->previous;
+		}
+		node->list = nullptr;
+	}
+
+	void doFreeNode(Node * node)
+	{
+		node->get().~T();
+		node->id = 0;
+		node->next = freeNode;
+		freeNode = node;
+	}
+
+	static void doDestroyList(NodeList & list)
+	{
+		Node * node = list.head;
+		while(node != nullptr) {
+			Node * next = node->next;
+			node->get().~T();
+			delete node;
+			node = next;
+		}
+		list.head = nullptr;
+		list.tail = nullptr;
+	}
+
+private:
+	std::array<std::array<NodeList, slotCount>, levelCount> levelList;
+	NodeList dueList;
+	// The items being expired by advance.
+	NodeList expiringList;
+	uint64_t currentTick;
+	uint64_t nextId;
+	std::size_t itemCount;
+	Node * freeNode;
+};
+
+
+} //namespace eventpp
+
+
+#endif
+
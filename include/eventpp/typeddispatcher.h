@@ -0,0 +1,379 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TYPEDDISPATCHER_H_872604596137
+#define TYPEDDISPATCHER_H_872604596137
+
+#include "callbacklist.h"
+
+#include <tuple>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include <cstddef>
+
+namespace eventpp {
+
+// The event types which are known at compile time.
+template <typename ...Events>
+struct TypedEventList
+{
+};
+
+// Specialize TypedEventBaseOf to declare the direct base event of an event class,
+// then the listeners of the base event also receive the derived events.
+// template <> struct TypedEventBaseOf<FillEvent> { using Type = OrderEvent; };
+template <typename E>
+struct TypedEventBaseOf
+{
+	using Type = void;
+};
+
+namespace internal_ {
+
+template <typename T, typename ...Types>
+struct IndexOfType;
+
+template <typename T>
+struct IndexOfType <T>
+{
+	enum { value = -1 };
+};
+
+template <typename T, typename ...Types>
+struct IndexOfType <T, T, Types...>
+{
+	enum { value = 0 };
+};
+
+template <typename T, typename U, typename ...Types>
+struct IndexOfType <T, U, Types...>
+{
+	enum {
+		value = IndexOfType<T, Types...>::value < 0 ? -1 : 1 + IndexOfType<T, Types...>::value
+	};
+};
+
+// Each event type that is not known at compile time gets a unique index on first use.
+inline std::size_t getNextTypedEventIndex()
+{
+	static std::atomic<std::size_t> nextIndex(0);
+	return nextIndex.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename E>
+struct TypedEventIndex
+{
+	static std::size_t get() {
+		static const std::size_t index = getNextTypedEventIndex();
+		return index;
+	}
+};
+
+// Only the threading policy is passed to the callback lists,
+// since each event type has its own callback prototype.
+template <typename Policies>
+struct TypedCallbackListPolicies
+{
+	using Threading = typename SelectThreading<Policies, HasTypeThreading<Policies>::value>::Type;
+};
+
+template <
+	typename EventList,
+	typename Policies
+>
+class TypedEventDispatcherBase;
+
+template <
+	typename PoliciesType,
+	typename ...StaticEvents
+>
+class TypedEventDispatcherBase <
+	TypedEventList<StaticEvents...>,
+	PoliciesType
+>
+{
+protected:
+	using Policies = PoliciesType;
+
+	using Threading = typename SelectThreading<Policies, HasTypeThreading<Policies>::value>::Type;
+	using Mutex = typename Threading::Mutex;
+
+	template <typename E>
+	using CallbackList_ = CallbackList<void (const E &), TypedCallbackListPolicies<Policies> >;
+
+	template <typename E>
+	struct IsStaticEvent
+	{
+		enum { value = IndexOfType<E, StaticEvents...>::value >= 0 };
+	};
+
+	struct SlotBase
+	{
+		virtual ~SlotBase() {}
+	};
+
+	// baseSlot is linked when the slot is created, so dispatching walks the
+	// precomputed pointers to the slots of the base events, without any look up.
+	template <typename E, typename Base = typename TypedEventBaseOf<E>::Type>
+	struct Slot : public SlotBase
+	{
+		static_assert(std::is_base_of<Base, E>::value, "TypedEventBaseOf<E>::Type must be a base class of E.");
+
+		Slot() : callbackList(), baseSlot(nullptr) {}
+
+		CallbackList_<E> callbackList;
+		Slot<Base> * baseSlot;
+	};
+
+	template <typename E>
+	struct Slot <E, void> : public SlotBase
+	{
+		CallbackList_<E> callbackList;
+	};
+
+	using StaticSlots = std::tuple<Slot<StaticEvents>...>;
+	using DynamicSlots = std::vector<std::unique_ptr<SlotBase> >;
+
+public:
+	template <typename E>
+	using Handle = typename CallbackList_<E>::Handle;
+
+	template <typename E>
+	using Callback = typename CallbackList_<E>::Callback;
+
+public:
+	TypedEventDispatcherBase()
+		:
+			staticSlots(),
+			dynamicSlots(),
+			dynamicSlotsMutex()
+	{
+		using Expander = int[];
+		(void)Expander { 0, (doLinkBaseSlot(doGetSlot<StaticEvents>(IsStaticEventTag<StaticEvents>())), 0)... };
+	}
+
+	TypedEventDispatcherBase(TypedEventDispatcherBase &&) = delete;
+	TypedEventDispatcherBase(const TypedEventDispatcherBase &) = delete;
+	TypedEventDispatcherBase & operator = (const TypedEventDispatcherBase &) = delete;
+
+	template <typename E>
+	Handle<E> appendListener(const Callback<E> & callback)
+	{
+		return doGetSlot<E>(IsStaticEventTag<E>()).callbackList.append(callback);
+	}
+
+	template <typename E>
+	Handle<E> prependListener(const Callback<E> & callback)
+	{
+		return doGetSlot<E>(IsStaticEventTag<E>()).callbackList.prepend(callback);
+	}
+
+	template <typename E>
+	Handle<E> insertListener(const Callback<E> & callback, const Handle<E> before)
+	{
+		return doGetSlot<E>(IsStaticEventTag<E>()).callbackList.insert(callback, before);
+	}
+
+	template <typename E>
+	bool removeListener(const Handle<E> handle)
+	{
+		Slot<E> * slot = doFindSlot<E>(IsStaticEventTag<E>());
+		if(slot) {
+			return slot->callbackList.remove(handle);
+		}
+
+		return false;
+	}
+
+	template <typename E, typename Func>
+	void forEach(Func && func) const
+	{
+		const Slot<E> * slot = doFindSlot<E>(IsStaticEventTag<E>());
+		if(slot) {
+			slot->callbackList.forEach(std::forward<Func>(func));
+		}
+	}
+
+	template <typename E, typename Func>
+	bool forEachIf(Func && func) const
+	{
+		const Slot<E> * slot = doFindSlot<E>(IsStaticEventTag<E>());
+		if(slot) {
+			return slot->callbackList.forEachIf(std::forward<Func>(func));
+		}
+
+		return true;
+	}
+
+	// The event type is the static type of e, not the dynamic type.
+	// The listeners of E are invoked first, then the listeners of the base events declared
+	// by TypedEventBaseOf, from the direct base to the root.
+	template <typename E>
+	void dispatch(const E & e) const
+	{
+		doDispatch<E>(e);
+	}
+
+protected:
+	template <typename E>
+	using IsStaticEventTag = std::integral_constant<bool, IsStaticEvent<E>::value>;
+
+	template <typename E>
+	void doDispatch(const E & e) const
+	{
+		const Slot<E> * slot = doFindSlot<E>(IsStaticEventTag<E>());
+		if(slot) {
+			doInvokeSlot(*slot, e);
+		}
+		else {
+			// No listener was ever added to E, the base events may still have listeners.
+			doDispatchBase(e, std::integral_constant<bool, std::is_void<typename TypedEventBaseOf<E>::Type>::value>());
+		}
+	}
+
+	template <typename E>
+	void doDispatchBase(const E & e, std::false_type) const
+	{
+		doDispatch<typename TypedEventBaseOf<E>::Type>(e);
+	}
+
+	template <typename E>
+	void doDispatchBase(const E & /*e*/, std::true_type) const
+	{
+	}
+
+	template <typename E, typename Base>
+	void doInvokeSlot(const Slot<E, Base> & slot, const E & e) const
+	{
+		slot.callbackList(e);
+		doInvokeSlot(*slot.baseSlot, static_cast<const Base &>(e));
+	}
+
+	template <typename E>
+	void doInvokeSlot(const Slot<E, void> & slot, const E & e) const
+	{
+		slot.callbackList(e);
+	}
+
+	template <typename E, typename Base>
+	void doLinkBaseSlot(Slot<E, Base> & slot)
+	{
+		slot.baseSlot = &doGetSlot<Base>(IsStaticEventTag<Base>());
+	}
+
+	template <typename E>
+	void doLinkBaseSlot(Slot<E, void> & /*slot*/)
+	{
+	}
+
+	// Static events are resolved at compile time, there is no look up and no lock.
+	// Their base slots are linked in the constructor.
+	template <typename E>
+	Slot<E> & doGetSlot(std::true_type)
+	{
+		return std::get<IndexOfType<E, StaticEvents...>::value>(staticSlots);
+	}
+
+	template <typename E>
+	Slot<E> * doFindSlot(std::true_type)
+	{
+		return &std::get<IndexOfType<E, StaticEvents...>::value>(staticSlots);
+	}
+
+	template <typename E>
+	const Slot<E> * doFindSlot(std::true_type) const
+	{
+		return &std::get<IndexOfType<E, StaticEvents...>::value>(staticSlots);
+	}
+
+	// Other events are held in a table indexed by TypedEventIndex.
+	// A slot is never freed before the dispatcher is destroyed, so the returned pointers remain valid.
+	template <typename E>
+	Slot<E> & doGetSlot(std::false_type)
+	{
+		Slot<E> * slot = doFindSlot<E>(std::false_type());
+		if(slot) {
+			return *slot;
+		}
+
+		// Create the slot and link the base slots outside of the lock,
+		// since creating the base slots locks the mutex too.
+		std::unique_ptr<Slot<E> > newSlot(new Slot<E>());
+		doLinkBaseSlot(*newSlot);
+
+		const std::size_t index = TypedEventIndex<E>::get();
+
+		std::lock_guard<Mutex> lockGuard(dynamicSlotsMutex);
+
+		if(index >= dynamicSlots.size()) {
+			dynamicSlots.resize(index + 1);
+		}
+		if(! dynamicSlots[index]) {
+			dynamicSlots[index] = std::move(newSlot);
+		}
+		return *static_cast<Slot<E> *>(dynamicSlots[index].get());
+	}
+
+	template <typename E>
+	Slot<E> * doFindSlot(std::false_type)
+	{
+		return doFindDynamicSlotHelper<E>(this);
+	}
+
+	template <typename E>
+	const Slot<E> * doFindSlot(std::false_type) const
+	{
+		return doFindDynamicSlotHelper<E>(this);
+	}
+
+private:
+	// template helper to avoid code duplication in doFindSlot
+	template <typename E, typename T>
+	static auto doFindDynamicSlotHelper(T * self)
+		-> typename std::conditional<std::is_const<T>::value, const Slot<E> *, Slot<E> *>::type
+	{
+		const std::size_t index = TypedEventIndex<E>::get();
+
+		std::lock_guard<Mutex> lockGuard(self->dynamicSlotsMutex);
+
+		if(index < self->dynamicSlots.size() && self->dynamicSlots[index]) {
+			return static_cast<Slot<E> *>(self->dynamicSlots[index].get());
+		}
+		return nullptr;
+	}
+
+private:
+	StaticSlots staticSlots;
+	DynamicSlots dynamicSlots;
+	mutable Mutex dynamicSlotsMutex;
+};
+
+
+} //namespace internal_
+
+template <
+	typename EventList = TypedEventList<>,
+	typename Policies = DefaultPolicies
+>
+class TypedEventDispatcher : public internal_::TypedEventDispatcherBase<EventList, Policies>
+{
+};
+
+
+} //namespace eventpp
+
+
+#endif
@@ -34,6 +34,15 @@ struct ReplaceReturnType <RT (Args...), Replacement>
 	using Type = Replacement (Args...);
 };
 
+template <typename F>
+struct CountArguments;
+
+template <typename RT, typename ...Args>
+struct CountArguments <RT (Args...)>
+{
+	enum { value = sizeof...(Args) };
+};
+
 
 } //namespace eventpp
 
@@ -13,6 +13,10 @@
 
 #include "test.h"
 #include "eventpp/callbacklist.h"
+#include "eventpp/eventqueue.h"
+#include "eventpp/queuelists/chunkqueuelist.h"
+#include "eventpp/queuelists/spscqueuelist.h"
+#include "eventpp/queuelists/arenaqueuelist.h"
 
 #include <chrono>
 #include <map>
@@ -20,6 +24,8 @@
 #include <random>
 #include <string>
 #include <iostream>
+#include <vector>
+#include <thread>
 
 // To enable benchmark, change below line to #if 1
 #if 0
@@ -457,4 +463,151 @@ TEST_CASE("benchmark, std::map vs std::unordered_map")
 	std::cout << unorderedMapInsertTime << " " << unorderedMapLookupTime << std::endl;
 }
 
+namespace {
+
+struct ChunkQueueListPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::ChunkQueueList<>::QueueList<Item, Policies>;
+};
+
+template <typename Policies, typename Payload, typename MakePayload>
+uint64_t measureQueueProcess(const int iterateCount, const int batchSize, MakePayload && makePayload)
+{
+	eventpp::EventQueue<int, void (const Payload &), Policies> queue;
+	queue.appendListener(3, [](const Payload &) {
+		++globalValue;
+	});
+
+	return measureElapsedTime([iterateCount, batchSize, &queue, &makePayload]() {
+		for(int i = 0; i < iterateCount; i += batchSize) {
+			for(int k = 0; k < batchSize; ++k) {
+				queue.enqueue(3, makePayload(k));
+			}
+			queue.process();
+		}
+	});
+}
+
+} //unnamed namespace
+
+TEST_CASE("benchmark, EventQueue ListQueueList vs ChunkQueueList")
+{
+	constexpr int iterateCount = 1000 * 1000 * 10;
+	constexpr int batchSize = 1000;
+
+	{
+		auto makePayload = [](const int k) -> int {
+			return k;
+		};
+		const uint64_t listTime = measureQueueProcess<eventpp::DefaultPolicies, int>(iterateCount, batchSize, makePayload);
+		const uint64_t chunkTime = measureQueueProcess<ChunkQueueListPolicies, int>(iterateCount, batchSize, makePayload);
+		std::cout << "int: " << listTime << " " << chunkTime << std::endl;
+	}
+
+	{
+		struct Payload
+		{
+			std::string s;
+			std::vector<int> v;
+		};
+		const std::string text = generateRandomString(64);
+		auto makePayload = [&text](const int k) -> Payload {
+			return Payload { text, std::vector<int>(16, k) };
+		};
+		const uint64_t listTime = measureQueueProcess<eventpp::DefaultPolicies, Payload>(iterateCount / 10, batchSize, makePayload);
+		const uint64_t chunkTime = measureQueueProcess<ChunkQueueListPolicies, Payload>(iterateCount / 10, batchSize, makePayload);
+		std::cout << "string + vector: " << listTime << " " << chunkTime << std::endl;
+	}
+}
+
+namespace {
+
+struct SpscQueueListPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::SpscQueueList<1024 * 64>::QueueList<Item, Policies>;
+};
+
+// One producer thread enqueues, the calling thread waits and processes.
+template <typename Policies>
+uint64_t measureQueueProducerConsumer(const int iterateCount)
+{
+	eventpp::EventQueue<int, void (int), Policies> queue;
+	int processedCount = 0;
+	queue.appendListener(3, [&processedCount](int) {
+		++processedCount;
+	});
+
+	return measureElapsedTime([iterateCount, &queue, &processedCount]() {
+		std::thread producer([iterateCount, &queue]() {
+			for(int i = 0; i < iterateCount; ++i) {
+				queue.enqueue(3, i);
+			}
+		});
+		while(processedCount < iterateCount) {
+			queue.wait();
+			queue.process();
+		}
+		producer.join();
+	});
+}
+
+} //unnamed namespace
+
+TEST_CASE("benchmark, EventQueue one producer one consumer")
+{
+	constexpr int iterateCount = 1000 * 1000 * 10;
+
+	{
+		auto makePayload = [](const int k) -> int {
+			return k;
+		};
+		const uint64_t listTime = measureQueueProcess<eventpp::DefaultPolicies, int>(iterateCount, 1000, makePayload);
+		const uint64_t spscTime = measureQueueProcess<SpscQueueListPolicies, int>(iterateCount, 1000, makePayload);
+		std::cout << "Single thread: " << listTime << " " << spscTime << std::endl;
+	}
+
+	{
+		const uint64_t listTime = measureQueueProducerConsumer<eventpp::DefaultPolicies>(iterateCount);
+		const uint64_t spscTime = measureQueueProducerConsumer<SpscQueueListPolicies>(iterateCount);
+		std::cout << "Two threads: " << listTime << " " << spscTime << std::endl;
+	}
+}
+
+namespace {
+
+struct ArenaQueueListPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::ArenaQueueList<1024 * 256>::QueueList<Item, Policies>;
+};
+
+} //unnamed namespace
+
+TEST_CASE("benchmark, EventQueue std::string vs ArenaQueueList ByteView")
+{
+	constexpr int iterateCount = 1000 * 1000;
+	constexpr int batchSize = 1000;
+
+	// The payload sizes are from 16 bytes to 64 KB, the small ones are more common.
+	const std::string text = generateRandomString(64 * 1024);
+	std::vector<std::size_t> sizeList;
+	for(std::size_t size = 16; size <= 64 * 1024; size *= 2) {
+		for(std::size_t count = (64 * 1024) / size; count > 0; count /= 2) {
+			sizeList.push_back(size);
+		}
+	}
+
+	auto makeString = [&text, &sizeList](const int k) -> std::string {
+		return std::string(text.data(), sizeList[k % sizeList.size()]);
+	};
+	auto makeByteView = [&text, &sizeList](const int k) -> eventpp::ByteView {
+		return eventpp::ByteView(text.data(), sizeList[k % sizeList.size()]);
+	};
+	const uint64_t listTime = measureQueueProcess<eventpp::DefaultPolicies, std::string>(iterateCount, batchSize, makeString);
+	const uint64_t arenaTime = measureQueueProcess<ArenaQueueListPolicies, eventpp::ByteView>(iterateCount, batchSize, makeByteView);
+	std::cout << "Variable size payload: " << listTime << " " << arenaTime << std::endl;
+}
+
 #endif
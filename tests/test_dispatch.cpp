@@ -14,11 +14,21 @@
 #include "test.h"
 #include "eventpp/eventdispatcher.h"
 #include "eventpp/mixins/mixinfilter.h"
+#include "eventpp/mixins/mixindispatchtimer.h"
+#include "eventpp/mixins/mixinstaticfilter.h"
+#include "eventpp/mixins/mixinrecorder.h"
 
 #include <thread>
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
 
 TEST_CASE("dispatch, std::string, void (const std::string &)")
 {
@@ -167,6 +177,149 @@ TEST_CASE("dispatch inside dispatch, int, void ()")
 	REQUIRE(b == 8);
 }
 
+TEST_CASE("dispatch, empty callback list is erased after last listener is removed")
+{
+	// Expose the protected doFindCallableList to check whether the list is in the map.
+	struct Dispatcher : public eventpp::EventDispatcher<int, void ()>
+	{
+		using eventpp::EventDispatcher<int, void ()>::doFindCallableList;
+	};
+	Dispatcher dispatcher;
+	constexpr int event = 3;
+
+	int a = 1;
+
+	Dispatcher::Handle ha = dispatcher.appendListener(event, [&a]() {
+		++a;
+	});
+	Dispatcher::Handle hb = dispatcher.appendListener(event, [&a]() {
+		++a;
+	});
+	REQUIRE(dispatcher.doFindCallableList(event));
+
+	REQUIRE(dispatcher.removeListener(event, ha));
+	REQUIRE(dispatcher.doFindCallableList(event));
+
+	REQUIRE(dispatcher.removeListener(event, hb));
+	REQUIRE(! dispatcher.doFindCallableList(event));
+	REQUIRE(! dispatcher.removeListener(event, hb));
+
+	dispatcher.dispatch(event);
+	REQUIRE(a == 1);
+
+	// The listener removes itself and adds a new one during dispatching,
+	// the new listener must not be triggered in the same dispatching.
+	Dispatcher::Handle hc;
+	hc = dispatcher.appendListener(event, [&a, &dispatcher, &hc, event]() {
+		a += 2;
+		dispatcher.removeListener(event, hc);
+		dispatcher.appendListener(event, [&a]() {
+			a += 5;
+		});
+	});
+	dispatcher.dispatch(event);
+	REQUIRE(a == 3);
+	REQUIRE(dispatcher.doFindCallableList(event));
+
+	dispatcher.dispatch(event);
+	REQUIRE(a == 8);
+}
+
+namespace {
+
+template <typename Policies>
+void testCallbackListErasedDuringDispatching()
+{
+	struct Dispatcher : public eventpp::EventDispatcher<int, void (), Policies>
+	{
+		using eventpp::EventDispatcher<int, void (), Policies>::doFindCallableList;
+	};
+	Dispatcher dispatcher;
+	constexpr int event = 3;
+	constexpr int otherEvent = 5;
+
+	std::vector<int> dataList;
+
+	// The erased list is dispatched by a raw pointer, it's kept alive until no dispatching is running.
+	typename Dispatcher::Handle ha;
+	typename Dispatcher::Handle hb;
+	ha = dispatcher.appendListener(event, [&dispatcher, &dataList, &ha, &hb, event, otherEvent]() {
+		dataList.push_back(1);
+		dispatcher.removeListener(event, ha);
+		dispatcher.removeListener(event, hb);
+		dispatcher.dispatch(otherEvent);
+	});
+	hb = dispatcher.appendListener(event, [&dataList]() {
+		dataList.push_back(2);
+	});
+	dispatcher.appendListener(otherEvent, [&dispatcher, &dataList, event]() {
+		dataList.push_back(5);
+		REQUIRE(! dispatcher.doFindCallableList(event));
+	});
+
+	dispatcher.dispatch(event);
+	REQUIRE(dataList == std::vector<int>{ 1, 5 });
+	REQUIRE(! dispatcher.doFindCallableList(event));
+
+	dispatcher.dispatch(event);
+	REQUIRE(dataList == std::vector<int>{ 1, 5 });
+}
+
+struct SingleThreadingPolicies
+{
+	using Threading = eventpp::SingleThreading;
+};
+
+} //unnamed namespace
+
+TEST_CASE("dispatch, SingleThreading, callback list erased during dispatching")
+{
+	testCallbackListErasedDuringDispatching<SingleThreadingPolicies>();
+}
+
+TEST_CASE("dispatch, callback list erased during dispatching")
+{
+	testCallbackListErasedDuringDispatching<eventpp::DefaultPolicies>();
+}
+
+TEST_CASE("dispatch multi threading, add/remove/dispatch erases empty callback lists")
+{
+	struct Dispatcher : public eventpp::EventDispatcher<int, void (int)>
+	{
+		using eventpp::EventDispatcher<int, void (int)>::doFindCallableList;
+	};
+	Dispatcher dispatcher;
+
+	constexpr int threadCount = 64;
+	constexpr int eventCount = 16;
+	constexpr int loopCount = 1024;
+
+	std::atomic<int> callCount(0);
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([i, &dispatcher, &callCount]() {
+			for(int k = 0; k < loopCount; ++k) {
+				const int event = (i + k) % eventCount;
+				auto handle = dispatcher.appendListener(event, [&callCount](int) {
+					++callCount;
+				});
+				dispatcher.dispatch(event);
+				dispatcher.removeListener(event, handle);
+				dispatcher.dispatch((event + 1) % eventCount);
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+
+	REQUIRE(callCount.load() >= threadCount * loopCount);
+	for(int i = 0; i < eventCount; ++i) {
+		REQUIRE(! dispatcher.doFindCallableList(i));
+	}
+}
+
 TEST_CASE("dispatch, int, void (const std::string &, int)")
 {
 	eventpp::EventDispatcher<int, void (const std::string &, int)> dispatcher;
@@ -377,6 +530,344 @@ TEST_CASE("event filter")
 	}
 }
 
+namespace {
+
+struct StaticFilterBlockLarge
+{
+	bool operator() (int e, int & /*index*/) const {
+		return e < 3;
+	}
+};
+
+struct StaticFilterCount
+{
+	bool operator() (int /*e*/, int & index) {
+		++count;
+		++index;
+		return true;
+	}
+
+	int count = 0;
+};
+
+} //unnamed namespace
+
+TEST_CASE("event static filter")
+{
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<
+			eventpp::MixinStaticFilter<StaticFilterCount, StaticFilterBlockLarge>::Mixin
+		>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int, int), MyPolicies>;
+	ED dispatcher;
+
+	constexpr int itemCount = 5;
+	std::vector<int> dataList(itemCount);
+
+	for(int i = 0; i < itemCount; ++i) {
+		dispatcher.appendListener(i, [&dataList](int e, int index) {
+			dataList[e] = index;
+		});
+	}
+
+	for(int i = 0; i < itemCount; ++i) {
+		dispatcher.dispatch(i, 58);
+	}
+
+	REQUIRE(dispatcher.getStaticFilter<0>().count == itemCount);
+	REQUIRE(dataList == std::vector<int>{ 59, 59, 59, 0, 0 });
+}
+
+namespace {
+
+template <typename Base>
+class MixinRecordBefore : public Base
+{
+public:
+	template <typename ...Args>
+	bool mixinBeforeDispatch(int e, Args && ...) const {
+		this->recordList->push_back(e * 10 + 1);
+		return e != 5;
+	}
+
+	std::vector<int> * recordList;
+};
+
+template <typename Base>
+class MixinRecordAfter : public Base
+{
+public:
+	template <typename ...Args>
+	void mixinAfterDispatch(int e, Args && ...) const {
+		this->recordList->push_back(e * 10 + 2);
+	}
+};
+
+template <typename Base>
+class MixinRecordBeforeAfter : public Base
+{
+public:
+	template <typename ...Args>
+	bool mixinBeforeDispatch(int e, Args && ...) const {
+		this->recordList->push_back(e * 10 + 3);
+		return true;
+	}
+
+	template <typename ...Args>
+	void mixinAfterDispatch(int e, Args && ...) const {
+		this->recordList->push_back(e * 10 + 4);
+	}
+};
+
+template <typename Base>
+class MixinThrowAfter : public Base
+{
+public:
+	template <typename ...Args>
+	void mixinAfterDispatch(int e, Args && ...) const {
+		if(e == 7) {
+			throw std::runtime_error("mixinAfterDispatch");
+		}
+	}
+};
+
+} //unnamed namespace
+
+TEST_CASE("dispatch, mixinBeforeDispatch and mixinAfterDispatch")
+{
+	// MixinRecordAfter is in front of MixinRecordBeforeAfter,
+	// MixinRecordBeforeAfter::mixinAfterDispatch must be only invoked once.
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<MixinRecordBeforeAfter, MixinRecordAfter, MixinRecordBefore>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int, const std::string &), MyPolicies>;
+	ED dispatcher;
+
+	std::vector<int> recordList;
+	dispatcher.recordList = &recordList;
+
+	std::string received;
+	dispatcher.appendListener(3, [&recordList, &received](int e, const std::string & s) {
+		recordList.push_back(e * 10);
+		received = s;
+	});
+
+	dispatcher.dispatch(3, std::string("hello"));
+	REQUIRE(recordList == std::vector<int>{ 33, 31, 30, 32, 34 });
+	REQUIRE(received == "hello");
+
+	// MixinRecordBefore blocks event 5, the listeners are not invoked,
+	// the mixins before it still have mixinAfterDispatch invoked.
+	recordList.clear();
+	dispatcher.dispatch(5, std::string("world"));
+	REQUIRE(recordList == std::vector<int>{ 53, 51, 52, 54 });
+}
+
+TEST_CASE("dispatch, mixinAfterDispatch throws")
+{
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<MixinRecordBeforeAfter, MixinThrowAfter, MixinRecordBefore>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int), MyPolicies>;
+	ED dispatcher;
+
+	std::vector<int> recordList;
+	dispatcher.recordList = &recordList;
+	dispatcher.appendListener(7, [&recordList](int e) {
+		recordList.push_back(e * 10);
+	});
+
+	// The exception is propagated, and the mixins before the throwing one still have mixinAfterDispatch invoked.
+	REQUIRE_THROWS(dispatcher.dispatch(7));
+	REQUIRE(recordList == std::vector<int>{ 73, 71, 70, 74 });
+}
+
+TEST_CASE("dispatch, MixinDispatchTimer")
+{
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<eventpp::MixinDispatchTimer, eventpp::MixinFilter>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int), MyPolicies>;
+	ED dispatcher;
+
+	dispatcher.appendListener(3, [&dispatcher](int) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		// nested dispatching is timed separately.
+		dispatcher.dispatch(5);
+	});
+	dispatcher.appendFilter([](int e) -> bool {
+		return e != 8;
+	});
+
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 0);
+
+	dispatcher.dispatch(3);
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 2);
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getMax() >= 2 * 1000 * 1000);
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getMin() < 2 * 1000 * 1000);
+
+	// The dispatching blocked by the filter is still timed.
+	dispatcher.dispatch(8);
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 3);
+
+	dispatcher.resetDispatchTimeHistogram();
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 0);
+}
+
+TEST_CASE("dispatch, MixinDispatchTimer, listener throws")
+{
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<eventpp::MixinDispatchTimer>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int), MyPolicies>;
+	ED dispatcher;
+
+	dispatcher.appendListener(3, [](int) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	});
+	dispatcher.appendListener(4, [](int) {
+		throw std::runtime_error("listener");
+	});
+	dispatcher.appendListener(5, [&dispatcher](int) {
+		dispatcher.dispatch(4);
+	});
+
+	REQUIRE_THROWS(dispatcher.dispatch(4));
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 1);
+	REQUIRE_THROWS(dispatcher.dispatch(5));
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 3);
+
+	// The thrown dispatching doesn't leave its start time to the next one.
+	dispatcher.resetDispatchTimeHistogram();
+	dispatcher.dispatch(3);
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getCount() == 1);
+	REQUIRE(dispatcher.getDispatchTimeHistogram().getMin() >= 2 * 1000 * 1000);
+}
+
+TEST_CASE("event filter, per event filters")
+{
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<eventpp::MixinFilter>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int, int), MyPolicies>;
+	ED dispatcher;
+
+	constexpr int itemCount = 5;
+	std::vector<int> dataList(itemCount);
+
+	for(int i = 0; i < itemCount; ++i) {
+		dispatcher.appendListener(i, [&dataList](int e, int index) {
+			dataList[e] = index;
+		});
+	}
+
+	std::vector<int> filterData(3);
+	dispatcher.appendFilter([&filterData](int /*e*/, int & index) -> bool {
+		++filterData[0];
+		++index;
+		return true;
+	});
+	auto handle1 = dispatcher.appendFilter(1, [&filterData](int e, int & index) -> bool {
+		++filterData[1];
+		index += e;
+		return true;
+	});
+	auto handle3 = dispatcher.appendFilter(3, [&filterData](int /*e*/, int /*index*/) -> bool {
+		++filterData[2];
+		return false;
+	});
+
+	for(int i = 0; i < itemCount; ++i) {
+		dispatcher.dispatch(i, 58);
+	}
+
+	// The global filter is invoked for all events, the event filters only for their own events.
+	REQUIRE(filterData == std::vector<int>{ itemCount, 1, 1 });
+	REQUIRE(dataList == std::vector<int>{ 59, 60, 59, 0, 59 });
+
+	REQUIRE(dispatcher.removeFilter(3, handle3));
+	REQUIRE(! dispatcher.removeFilter(3, handle3));
+	REQUIRE(dispatcher.removeFilter(1, handle1));
+
+	std::fill(dataList.begin(), dataList.end(), 0);
+	for(int i = 0; i < itemCount; ++i) {
+		dispatcher.dispatch(i, 58);
+	}
+	REQUIRE(filterData == std::vector<int>{ itemCount * 2, 1, 1 });
+	REQUIRE(dataList == std::vector<int>{ 59, 59, 59, 59, 59 });
+
+	// The filter list of an event can be replaced during dispatching the event.
+	ED::FilterHandle handle2;
+	handle2 = dispatcher.appendFilter(2, [&dispatcher, &handle2, &filterData](int /*e*/, int & index) -> bool {
+		REQUIRE(dispatcher.removeFilter(2, handle2));
+		dispatcher.appendFilter(2, [&filterData](int /*e*/, int /*index*/) -> bool {
+			++filterData[2];
+			return false;
+		});
+		index = 0;
+		return true;
+	});
+	dispatcher.dispatch(2, 58);
+	REQUIRE(dataList[2] == 0);
+	dispatcher.dispatch(2, 58);
+	REQUIRE(dataList[2] == 0);
+	REQUIRE(filterData[2] == 2);
+
+	// The arguments only hook still accepts any arguments.
+	REQUIRE(dispatcher.mixinBeforeDispatch(1, 2));
+}
+
+TEST_CASE("event filter multi threading, per event filters")
+{
+	struct MyPolicies {
+		using Mixins = eventpp::MixinList<eventpp::MixinFilter>;
+	};
+	using ED = eventpp::EventDispatcher<int, void (int), MyPolicies>;
+	ED dispatcher;
+
+	constexpr int eventCount = 8;
+	constexpr int threadCount = 4;
+	constexpr int dispatchCountPerThread = 20000;
+
+	std::atomic<int> listenerCount(0);
+	for(int i = 0; i < eventCount; ++i) {
+		dispatcher.appendListener(i, [&listenerCount](int) {
+			++listenerCount;
+		});
+	}
+
+	// The filters never stop the dispatching, they are added and removed while dispatching.
+	std::atomic<bool> stopped(false);
+	std::thread filterThread([&dispatcher, &stopped]() {
+		int e = 0;
+		while(! stopped.load()) {
+			auto handle = dispatcher.appendFilter(e, [](int) -> bool {
+				return true;
+			});
+			std::this_thread::yield();
+			dispatcher.removeFilter(e, handle);
+			e = (e + 1) % eventCount;
+		}
+	});
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([&dispatcher]() {
+			for(int k = 0; k < dispatchCountPerThread; ++k) {
+				dispatcher.dispatch(k % eventCount);
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+	stopped = true;
+	filterThread.join();
+
+	REQUIRE(listenerCount.load() == threadCount * dispatchCountPerThread);
+}
+
 TEST_CASE("dispatch multi threading, int, void (int)")
 {
 	using ED = eventpp::EventDispatcher<int, void (int)>;
@@ -458,3 +949,82 @@ TEST_CASE("dispatch explicit single threading, int, void (int)")
 	REQUIRE(b == 10);
 }
 
+namespace {
+
+struct RecorderPolicies
+{
+	using Mixins = eventpp::MixinList<eventpp::MixinRecorder>;
+
+	static void serializeEvent(std::string & data, const int & e, const std::string & s) {
+		data.append(reinterpret_cast<const char *>(&e), sizeof(e));
+		data.append(s);
+	}
+
+	static bool deserializeEvent(const char * data, const std::size_t size, int & e, std::string & s) {
+		if(size < sizeof(e)) {
+			return false;
+		}
+		std::memcpy(&e, data, sizeof(e));
+		s.assign(data + sizeof(e), size - sizeof(e));
+		return true;
+	}
+};
+
+} //unnamed namespace
+
+TEST_CASE("dispatch, MixinRecorder")
+{
+	using ED = eventpp::EventDispatcher<int, void (const std::string &), RecorderPolicies>;
+	const std::string fileName = "eventpp_test_recording.bin";
+
+	std::vector<std::string> dataList;
+	auto appendListeners = [&dataList](ED & dispatcher) {
+		for(int e = 1; e <= 2; ++e) {
+			dispatcher.appendListener(e, [&dataList, e](const std::string & s) {
+				dataList.push_back(std::to_string(e) + s);
+			});
+		}
+	};
+
+	{
+		ED dispatcher;
+		appendListeners(dispatcher);
+
+		dispatcher.dispatch(1, "a");
+		REQUIRE(dispatcher.startRecording(fileName));
+		REQUIRE(dispatcher.isRecording());
+		dispatcher.dispatch(1, "b");
+		dispatcher.dispatch(2, "");
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		// Events without listeners are recorded too.
+		dispatcher.dispatch(3, "c");
+		dispatcher.dispatch(2, "d");
+		REQUIRE(dispatcher.getRecordedCount() == 4);
+		REQUIRE(dispatcher.stopRecording());
+		REQUIRE(! dispatcher.isRecording());
+		dispatcher.dispatch(1, "e");
+	}
+	REQUIRE(dataList == std::vector<std::string>({ "1a", "1b", "2", "2d", "1e" }));
+
+	dataList.clear();
+	ED dispatcher;
+	appendListeners(dispatcher);
+	REQUIRE(dispatcher.replayRecording(fileName) == 4);
+	REQUIRE(dataList == std::vector<std::string>({ "1b", "2", "2d" }));
+
+	dataList.clear();
+	const auto startTime = std::chrono::steady_clock::now();
+	REQUIRE(dispatcher.replayRecording(fileName, eventpp::ReplayPace::recorded) == 4);
+	REQUIRE(std::chrono::steady_clock::now() - startTime >= std::chrono::milliseconds(50));
+	REQUIRE(dataList == std::vector<std::string>({ "1b", "2", "2d" }));
+
+	std::vector<ED::RecordedEvent> recordedList;
+	REQUIRE(ED::readRecording(fileName, eventpp::ReplayPace::fastest, [&recordedList](ED::RecordedEvent & recordedEvent) {
+		recordedList.push_back(recordedEvent);
+	}) == 4);
+	REQUIRE(recordedList.size() == 4);
+	REQUIRE(recordedList[2] == ED::RecordedEvent(3, "c"));
+
+	REQUIRE(dispatcher.replayRecording("eventpp_test_recording_not_exist.bin") == 0);
+	std::remove(fileName.c_str());
+}
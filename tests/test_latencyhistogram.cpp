@@ -0,0 +1,85 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "test.h"
+#include "eventpp/latencyhistogram.h"
+
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+TEST_CASE("LatencyHistogram, record and percentile")
+{
+	eventpp::LatencyHistogram<> histogram;
+
+	REQUIRE(histogram.getCount() == 0);
+	REQUIRE(histogram.getMin() == 0);
+	REQUIRE(histogram.getMax() == 0);
+	REQUIRE(histogram.getValueAtPercentile(50) == 0);
+
+	for(uint64_t i = 1; i <= 1000; ++i) {
+		histogram.record(i);
+	}
+
+	REQUIRE(histogram.getCount() == 1000);
+	REQUIRE(histogram.getMin() == 1);
+	REQUIRE(histogram.getMax() == 1000);
+	REQUIRE(histogram.getMean() == Approx(500.5));
+
+	// small values are exact
+	REQUIRE(histogram.getValueAtPercentile(1) == 10);
+
+	// large values are within the precision of the buckets
+	const uint64_t median = histogram.getValueAtPercentile(50);
+	REQUIRE(median >= 500);
+	REQUIRE(median <= 500 + 500 / 32);
+	REQUIRE(histogram.getValueAtPercentile(100) == 1000);
+
+	uint64_t count = 0;
+	histogram.forEach([&count](uint64_t lowest, uint64_t highest, uint64_t bucketCount) {
+		REQUIRE(lowest <= highest);
+		count += bucketCount;
+	});
+	REQUIRE(count == 1000);
+
+	histogram.record(UINT64_MAX);
+	REQUIRE(histogram.getMax() == UINT64_MAX);
+	REQUIRE(histogram.getValueAtPercentile(100) == UINT64_MAX);
+
+	histogram.reset();
+	REQUIRE(histogram.getCount() == 0);
+}
+
+TEST_CASE("LatencyHistogram, multi threading")
+{
+	eventpp::LatencyHistogram<> histogram;
+
+	constexpr int threadCount = 16;
+	constexpr int recordCountPerThread = 10000;
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([i, &histogram]() {
+			for(int k = 0; k < recordCountPerThread; ++k) {
+				histogram.record((uint64_t)(i * recordCountPerThread + k));
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+
+	REQUIRE(histogram.getCount() == threadCount * recordCountPerThread);
+	REQUIRE(histogram.getMin() == 0);
+	REQUIRE(histogram.getMax() == threadCount * recordCountPerThread - 1);
+}
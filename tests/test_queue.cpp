@@ -13,6 +13,11 @@
 
 #include "test.h"
 #include "eventpp/eventqueue.h"
+#include "eventpp/mixins/mixintimedqueue.h"
+#include "eventpp/mixins/mixinparallelprocess.h"
+#include "eventpp/mixins/mixinstagedenqueue.h"
+#include "eventpp/mixins/mixinrecorder.h"
+#include "eventpp/queuelists/ringqueuelist.h"
 
 #include <thread>
 #include <numeric>
@@ -20,6 +25,24 @@
 #include <random>
 #include <vector>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <set>
+#include <cstring>
+#include <stdexcept>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include "eventpp/mixins/mixinjournal.h"
+#include <cstdlib>
+#define EVENTPP_TEST_JOURNAL
+#endif
 
 TEST_CASE("queue, std::string, void (const std::string &)")
 {
@@ -421,6 +444,278 @@ TEST_CASE("queue, peekEvent/takeEvent/dispatch")
 	}
 }
 
+TEST_CASE("queue, processOne/processCount/processFor/processUntil")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int)>;
+	EQ queue;
+
+	constexpr int itemCount = 100;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	std::vector<int> expectedList;
+	for(int i = 0; i < itemCount; ++i) {
+		queue.enqueue(3, i);
+		expectedList.push_back(i);
+	}
+
+	REQUIRE(queue.processOne());
+	REQUIRE(dataList == std::vector<int>{ 0 });
+
+	REQUIRE(queue.processCount(0) == 0);
+	REQUIRE(queue.processCount(9) == 9);
+	REQUIRE(dataList.size() == 10);
+	REQUIRE(dataList.back() == 9);
+
+	// The time point has passed, nothing is dispatched.
+	REQUIRE(queue.processUntil(std::chrono::steady_clock::now() - std::chrono::milliseconds(1)) == 0);
+	REQUIRE(queue.processFor(std::chrono::milliseconds(0)) == 0);
+	REQUIRE(dataList.size() == 10);
+
+	REQUIRE(queue.processCount(40) == 40);
+	REQUIRE(queue.processFor(std::chrono::seconds(10)) == 50);
+	REQUIRE(dataList == expectedList);
+	REQUIRE(queue.empty());
+
+	REQUIRE(! queue.processOne());
+	REQUIRE(queue.processCount(5) == 0);
+	REQUIRE(queue.processUntil(std::chrono::steady_clock::now() + std::chrono::seconds(10)) == 0);
+}
+
+TEST_CASE("queue, processFor leaves the remaining events in the queue")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int)>;
+	EQ queue;
+
+	constexpr int itemCount = 200;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	});
+
+	for(int i = 0; i < itemCount; ++i) {
+		queue.enqueue(3, i);
+	}
+
+	const std::size_t count = queue.processFor(std::chrono::milliseconds(10));
+	REQUIRE(count > 0);
+	REQUIRE(count < itemCount);
+	REQUIRE(dataList.size() == count);
+
+	queue.process();
+	std::vector<int> expectedList(itemCount);
+	std::iota(expectedList.begin(), expectedList.end(), 0);
+	REQUIRE(dataList == expectedList);
+}
+
+#if defined(__linux__)
+namespace {
+
+bool isFdReadable(const int fd, const int timeoutMilliseconds = 0)
+{
+	pollfd item {};
+	item.fd = fd;
+	item.events = POLLIN;
+	return ::poll(&item, 1, timeoutMilliseconds) == 1 && (item.revents & POLLIN) != 0;
+}
+
+} //unnamed namespace
+
+TEST_CASE("queue, getReadyFd/processReady")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int)>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList, &queue](int, const int n) {
+		dataList.push_back(n);
+		if(n == 2) {
+			queue.enqueue(3, 5);
+		}
+	});
+
+	// The events queued before the descriptor is created make it readable.
+	queue.enqueue(3, 1);
+	const int fd = queue.getReadyFd();
+	REQUIRE(fd >= 0);
+	REQUIRE(queue.getReadyFd() == fd);
+	REQUIRE(isFdReadable(fd));
+
+	REQUIRE(queue.processReady() == 1);
+	REQUIRE(dataList == std::vector<int>{ 1 });
+	REQUIRE(! isFdReadable(fd));
+
+	queue.enqueue(3, 2);
+	queue.enqueue(3, 3);
+	REQUIRE(isFdReadable(fd));
+
+	// The event enqueued by the listener makes the descriptor readable again.
+	REQUIRE(queue.processReady() == 2);
+	REQUIRE(dataList == std::vector<int>({ 1, 2, 3 }));
+	REQUIRE(isFdReadable(fd));
+
+	REQUIRE(queue.processReady() == 1);
+	REQUIRE(dataList == std::vector<int>({ 1, 2, 3, 5 }));
+	REQUIRE(! isFdReadable(fd));
+
+	REQUIRE(queue.processReady() == 0);
+}
+
+TEST_CASE("queue, processReady, multi threads")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int)>;
+	EQ queue;
+
+	constexpr int threadCount = 4;
+	constexpr int itemCount = 10000;
+
+	std::vector<int> dataList(itemCount);
+	queue.appendListener(3, [&dataList](int, const int n) {
+		++dataList[n];
+	});
+
+	const int fd = queue.getReadyFd();
+	REQUIRE(fd >= 0);
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([i, &queue]() {
+			for(int k = i; k < itemCount; k += threadCount) {
+				queue.enqueue(3, k);
+			}
+		});
+	}
+
+	int processedCount = 0;
+	while(processedCount < itemCount) {
+		// No event can be left in the queue while the descriptor is not readable.
+		REQUIRE(isFdReadable(fd, 5000));
+		processedCount += (int)queue.processReady();
+	}
+
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+
+	REQUIRE(std::all_of(dataList.begin(), dataList.end(), [](const int value) {
+		return value == 1;
+	}));
+}
+#endif
+
+TEST_CASE("queue, enqueueBatch")
+{
+	using EQ = eventpp::EventQueue<int, void (int, std::unique_ptr<int> &)>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, std::unique_ptr<int> & n) {
+		dataList.push_back(*n);
+	});
+	queue.appendListener(5, [&dataList](int, std::unique_ptr<int> & n) {
+		dataList.push_back(-*n);
+	});
+
+	std::vector<EQ::QueuedEvent> eventList;
+	REQUIRE(queue.enqueueBatch(std::make_move_iterator(eventList.begin()), std::make_move_iterator(eventList.end())) == 0);
+	REQUIRE(queue.empty());
+
+	for(int i = 0; i < 5; ++i) {
+		eventList.emplace_back(i % 2 == 0 ? 3 : 5, i % 2 == 0 ? 3 : 5, std::unique_ptr<int>(new int(i)));
+	}
+	queue.enqueue(3, std::unique_ptr<int>(new int(100)));
+	REQUIRE(queue.enqueueBatch(std::make_move_iterator(eventList.begin()), std::make_move_iterator(eventList.end())) == 5);
+	queue.enqueue(3, std::unique_ptr<int>(new int(101)));
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 100, 0, -1, 2, -3, 4, 101 });
+}
+
+namespace {
+
+struct MoveCounter
+{
+	static int copyCount;
+	static int moveCount;
+
+	explicit MoveCounter(const int value) : value(value) {
+	}
+
+	MoveCounter(const MoveCounter & other) : value(other.value) {
+		++copyCount;
+	}
+
+	MoveCounter(MoveCounter && other) : value(other.value) {
+		++moveCount;
+	}
+
+	MoveCounter & operator = (const MoveCounter & other) {
+		value = other.value;
+		++copyCount;
+		return *this;
+	}
+
+	MoveCounter & operator = (MoveCounter && other) {
+		value = other.value;
+		++moveCount;
+		return *this;
+	}
+
+	static void reset() {
+		copyCount = 0;
+		moveCount = 0;
+	}
+
+	int value;
+};
+
+int MoveCounter::copyCount = 0;
+int MoveCounter::moveCount = 0;
+
+} //unnamed namespace
+
+TEST_CASE("queue, emplace without intermediate copy or move")
+{
+	using EQ = eventpp::EventQueue<int, void (const MoveCounter &, const MoveCounter &)>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](const MoveCounter & a, const MoveCounter & b) {
+		dataList.push_back(a.value);
+		dataList.push_back(b.value);
+	});
+
+	MoveCounter a(1);
+
+	// enqueue passes the arguments by value, so each argument is copied or moved twice.
+	MoveCounter::reset();
+	queue.enqueue(3, a, MoveCounter(2));
+	REQUIRE(MoveCounter::copyCount == 1);
+	REQUIRE(MoveCounter::moveCount == 2);
+
+	// The arguments are constructed in the queue directly.
+	MoveCounter::reset();
+	queue.emplace(3, a, MoveCounter(4));
+	REQUIRE(MoveCounter::copyCount == 1);
+	REQUIRE(MoveCounter::moveCount == 1);
+
+	MoveCounter::reset();
+	queue.emplace(3, 5, 6);
+	REQUIRE(MoveCounter::copyCount == 0);
+	REQUIRE(MoveCounter::moveCount == 0);
+
+	MoveCounter::reset();
+	queue.process();
+	REQUIRE(MoveCounter::copyCount == 0);
+	REQUIRE(MoveCounter::moveCount == 0);
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 1, 4, 5, 6 });
+}
+
 TEST_CASE("queue multi threading, int, void (int)")
 {
 	using EQ = eventpp::EventQueue<int, void (int)>;
@@ -614,3 +909,1055 @@ TEST_CASE("queue multi threading, many threads wait")
 	REQUIRE(std::accumulate(dataList.begin(), dataList.end(), 0) == itemCount * 2);
 }
 
+
+TEST_CASE("queue, MixinTimedQueue, enqueueAfter/enqueueAt")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinTimedQueue>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	queue.enqueueAfter(std::chrono::milliseconds(30), 3, 1);
+	queue.enqueueAt(EQ::Clock::now() + std::chrono::milliseconds(10), 3, 2);
+	const EQ::TimerHandle handle = queue.enqueueAfter(std::chrono::milliseconds(20), 3, 3);
+	queue.enqueue(3, 4);
+	REQUIRE(queue.getTimerCount() == 3);
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 4 });
+
+	REQUIRE(queue.cancelTimer(handle));
+	REQUIRE(! queue.cancelTimer(handle));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 4, 2, 1 });
+	REQUIRE(queue.getTimerCount() == 0);
+	REQUIRE(queue.empty());
+}
+
+namespace {
+
+struct TimedRingPolicies
+{
+	using Mixins = eventpp::MixinList<eventpp::MixinTimedQueue>;
+
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::RingQueueList<2, eventpp::RingOverflow::block>::QueueList<Item, Policies>;
+};
+
+} //unnamed namespace
+
+// The due events are released in the consumer thread, they must not block on the full ring.
+TEST_CASE("queue, MixinTimedQueue, release to a full blocking ring")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), TimedRingPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	queue.enqueue(3, 1);
+	queue.enqueue(3, 2);
+	for(int i = 3; i <= 5; ++i) {
+		queue.enqueueAt(EQ::Clock::now(), 3, i);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	REQUIRE(queue.waitFor(std::chrono::milliseconds(0)));
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2 });
+	REQUIRE(queue.getTimerCount() == 0);
+	REQUIRE(queue.waitFor(std::chrono::milliseconds(0)));
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4 });
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4, 5 });
+	REQUIRE(queue.empty());
+	REQUIRE(! queue.waitFor(std::chrono::milliseconds(0)));
+}
+
+TEST_CASE("queue multi threading, MixinTimedQueue, wait wakes up at the deadline")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinTimedQueue>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int), Policies>;
+	EQ queue;
+
+	constexpr int stopEvent = 1;
+	constexpr int timedEvent = 2;
+
+	REQUIRE(! queue.waitFor(std::chrono::milliseconds(1)));
+
+	std::atomic<bool> shouldStop(false);
+	std::vector<EQ::Clock::time_point> timeList;
+	std::atomic<int> timedCount(0);
+	queue.appendListener(stopEvent, [&shouldStop](int) {
+		shouldStop = true;
+	});
+	queue.appendListener(timedEvent, [&timeList, &timedCount](int) {
+		timeList.push_back(EQ::Clock::now());
+		++timedCount;
+	});
+
+	std::thread thread([&queue, &shouldStop]() {
+		while(! shouldStop) {
+			queue.wait();
+			queue.process();
+		}
+	});
+
+	// Let the thread wait without any timers, enqueueAfter must wake it up to wait for the deadline.
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	const EQ::Clock::time_point startTime = EQ::Clock::now();
+	queue.enqueueAfter(std::chrono::milliseconds(50), timedEvent);
+	queue.enqueueAfter(std::chrono::milliseconds(20), timedEvent);
+
+	while(timedCount.load() < 2 && EQ::Clock::now() - startTime < std::chrono::seconds(5)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	queue.enqueue(stopEvent);
+	thread.join();
+
+	REQUIRE(timeList.size() == 2);
+	REQUIRE(timeList[0] - startTime >= std::chrono::milliseconds(20));
+	REQUIRE(timeList[1] - startTime >= std::chrono::milliseconds(50));
+	REQUIRE(timeList[1] - startTime < std::chrono::seconds(5));
+}
+
+namespace {
+
+// A mutex which records its address when mutexHookMode is 1,
+// and calls mutexUnlockHook after it's unlocked when mutexHookMode is 2.
+std::atomic<int> mutexHookMode(0);
+std::atomic<const void *> hookedMutexAddress(nullptr);
+std::function<void ()> mutexUnlockHook;
+
+struct HookedMutex : std::mutex
+{
+	void unlock()
+	{
+		std::mutex::unlock();
+		const int mode = mutexHookMode.load();
+		if(mode == 1) {
+			hookedMutexAddress = this;
+			mutexHookMode = 0;
+		}
+		else if(mode == 2 && hookedMutexAddress.load() == this) {
+			mutexHookMode = 0;
+			mutexUnlockHook();
+		}
+	}
+};
+
+struct HookedTimedQueuePolicies
+{
+	struct Threading
+	{
+		using Mutex = HookedMutex;
+
+		template <typename T>
+		using Atomic = std::atomic<T>;
+
+		using ConditionVariable = std::condition_variable_any;
+	};
+
+	using Mixins = eventpp::MixinList<eventpp::MixinTimedQueue>;
+};
+
+} //unnamed namespace
+
+// A timer is added after wait checks the timers and before it blocks, wait must not miss it.
+TEST_CASE("queue multi threading, MixinTimedQueue, enqueueAt while starting to wait")
+{
+	using EQ = eventpp::EventQueue<int, void (int), HookedTimedQueuePolicies>;
+	EQ queue;
+
+	constexpr int stopEvent = 1;
+	constexpr int timedEvent = 2;
+
+	std::vector<int> dataList;
+	queue.appendListener(stopEvent, [&dataList](const int e) {
+		dataList.push_back(e);
+	});
+	queue.appendListener(timedEvent, [&dataList](const int e) {
+		dataList.push_back(e);
+	});
+
+	// getTimerCount only locks the timer mutex.
+	mutexHookMode = 1;
+	queue.getTimerCount();
+	REQUIRE(hookedMutexAddress.load() != nullptr);
+
+	mutexUnlockHook = [&queue, timedEvent]() {
+		queue.enqueueAfter(std::chrono::milliseconds(10), timedEvent);
+	};
+
+	// The watchdog unblocks wait if the timer is missed.
+	std::atomic<bool> finished(false);
+	std::thread watchdog([&queue, &finished, stopEvent]() {
+		const EQ::Clock::time_point deadline = EQ::Clock::now() + std::chrono::seconds(2);
+		while(! finished.load() && EQ::Clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if(! finished.load()) {
+			queue.enqueue(stopEvent);
+		}
+	});
+
+	const EQ::Clock::time_point startTime = EQ::Clock::now();
+	mutexHookMode = 2;
+	queue.wait();
+	const EQ::Clock::duration elapsed = EQ::Clock::now() - startTime;
+	finished = true;
+	watchdog.join();
+	mutexUnlockHook = nullptr;
+
+	REQUIRE(mutexHookMode.load() == 0);
+	REQUIRE(elapsed >= std::chrono::milliseconds(10));
+	REQUIRE(elapsed < std::chrono::seconds(2));
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ timedEvent });
+}
+
+TEST_CASE("queue multi threading, MixinParallelProcess, processParallel")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinParallelProcess>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int), Policies>;
+	EQ queue;
+
+	constexpr int itemCount = 10000;
+	constexpr int workerCount = 4;
+
+	std::vector<std::atomic<int> > dataList(itemCount);
+	std::mutex threadIdMutex;
+	std::set<std::thread::id> threadIdSet;
+	queue.appendListener(3, [&dataList, &threadIdMutex, &threadIdSet](const int n) {
+		++dataList[n];
+		std::lock_guard<std::mutex> lockGuard(threadIdMutex);
+		threadIdSet.insert(std::this_thread::get_id());
+	});
+
+	for(int i = 0; i < itemCount; ++i) {
+		queue.enqueue(3, i);
+	}
+
+	SECTION("threads created by processParallel") {
+		queue.processParallel(workerCount);
+	}
+
+	SECTION("executor") {
+		std::vector<std::thread> threadList;
+		queue.processParallel(workerCount, [&threadList](std::function<void ()> task) {
+			threadList.emplace_back(std::move(task));
+		});
+		REQUIRE(threadList.size() == workerCount - 1);
+		for(auto & thread : threadList) {
+			thread.join();
+		}
+	}
+
+	REQUIRE(queue.empty());
+	REQUIRE(std::all_of(dataList.begin(), dataList.end(), [](const std::atomic<int> & n) {
+		return n.load() == 1;
+	}));
+	REQUIRE(threadIdSet.size() <= workerCount);
+}
+
+TEST_CASE("queue multi threading, MixinParallelProcess, order sensitive events")
+{
+	// Event 1 is order sensitive, event 2 is not.
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinParallelProcess>;
+
+		static bool isOrderInsensitive(const int e) {
+			return e != 1;
+		}
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+
+	constexpr int itemCount = 1000;
+
+	std::vector<int> orderedList;
+	bool inCallingThread = true;
+	const std::thread::id callingThreadId = std::this_thread::get_id();
+	queue.appendListener(1, [&orderedList, &inCallingThread, callingThreadId](int, const int n) {
+		orderedList.push_back(n);
+		if(std::this_thread::get_id() != callingThreadId) {
+			inCallingThread = false;
+		}
+	});
+	std::atomic<int> parallelCount(0);
+	queue.appendListener(2, [&parallelCount](int, int) {
+		++parallelCount;
+	});
+
+	std::vector<int> expectedList;
+	for(int i = 0; i < itemCount; ++i) {
+		queue.enqueue(i % 3 == 0 ? 1 : 2, i);
+		if(i % 3 == 0) {
+			expectedList.push_back(i);
+		}
+	}
+
+	queue.processParallel(3);
+
+	REQUIRE(orderedList == expectedList);
+	REQUIRE(inCallingThread);
+	REQUIRE(parallelCount.load() == itemCount - (int)expectedList.size());
+
+	// Nothing to process.
+	queue.processParallel(3);
+	REQUIRE(parallelCount.load() == itemCount - (int)expectedList.size());
+}
+
+TEST_CASE("queue multi threading, MixinParallelProcess, calling thread throws")
+{
+	// Event 1 is order sensitive and dispatched in the calling thread, event 2 is not.
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinParallelProcess>;
+
+		static bool isOrderInsensitive(const int e) {
+			return e != 1;
+		}
+	};
+	using EQ = eventpp::EventQueue<int, void (int), Policies>;
+	EQ queue;
+
+	constexpr int itemCount = 1000;
+
+	queue.appendListener(1, [](int) {
+		throw std::runtime_error("listener");
+	});
+	std::atomic<int> parallelCount(0);
+	queue.appendListener(2, [&parallelCount](int) {
+		std::this_thread::yield();
+		++parallelCount;
+	});
+
+	for(int i = 0; i < itemCount; ++i) {
+		queue.enqueue(2);
+	}
+
+	SECTION("listener throws") {
+		queue.enqueue(1);
+		REQUIRE_THROWS(queue.processParallel(4));
+	}
+
+	SECTION("executor throws") {
+		std::vector<std::thread> threadList;
+		REQUIRE_THROWS(queue.processParallel(4, [&threadList](std::function<void ()> task) {
+			if(! threadList.empty()) {
+				throw std::runtime_error("executor");
+			}
+			threadList.emplace_back(std::move(task));
+		}));
+		REQUIRE(threadList.size() == 1);
+		threadList.front().join();
+	}
+
+	// The started workers finish all events before processParallel returns.
+	REQUIRE(parallelCount.load() == itemCount);
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("queue multi threading, MixinParallelProcess, processPartitioned")
+{
+	// The first argument is the account, the events of the same account are dispatched in order.
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinParallelProcess>;
+
+		static int getPartitionKey(const int /*e*/, const int account, const int /*data*/) {
+			return account;
+		}
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+
+	constexpr int accountCount = 37;
+	constexpr int itemCount = 20000;
+	constexpr int workerCount = 4;
+
+	// Each account is only touched by one worker at a time, so no lock is needed.
+	std::vector<std::vector<int> > dataList(accountCount);
+	std::atomic<int> processedCount(0);
+	queue.appendListener(3, [&dataList, &processedCount](const int account, const int data) {
+		dataList[account].push_back(data);
+		++processedCount;
+	});
+
+	std::vector<std::vector<int> > expectedList(accountCount);
+	std::mt19937 engine(1);
+	for(int i = 0; i < itemCount; ++i) {
+		const int account = (int)(engine() % accountCount);
+		queue.enqueue(3, account, i);
+		expectedList[account].push_back(i);
+	}
+
+	SECTION("threads created by processPartitioned") {
+		queue.processPartitioned(workerCount);
+	}
+
+	SECTION("executor") {
+		std::vector<std::thread> threadList;
+		queue.processPartitioned(workerCount, [&threadList](std::function<void ()> task) {
+			threadList.emplace_back(std::move(task));
+		});
+		for(auto & thread : threadList) {
+			thread.join();
+		}
+	}
+
+	REQUIRE(queue.empty());
+	REQUIRE(processedCount.load() == itemCount);
+	REQUIRE(dataList == expectedList);
+}
+
+namespace {
+
+// Template and overloaded policy functions, the calls are counted to check they are detected.
+struct TemplateParallelPolicies
+{
+	using Mixins = eventpp::MixinList<eventpp::MixinParallelProcess>;
+
+	static std::atomic<int> & getCallCount() {
+		static std::atomic<int> callCount(0);
+		return callCount;
+	}
+
+	template <typename E>
+	static bool isOrderInsensitive(const E & e) {
+		++getCallCount();
+		return e != 1;
+	}
+
+	static long getPartitionKey(const int /*e*/, const int account, const int /*data*/) {
+		++getCallCount();
+		return account;
+	}
+
+	static long getPartitionKey(const int e, const std::string & /*data*/) {
+		return e;
+	}
+};
+
+} //unnamed namespace
+
+TEST_CASE("queue multi threading, MixinParallelProcess, template and overloaded policy functions")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), TemplateParallelPolicies>;
+	EQ queue;
+
+	static_assert(std::is_same<EQ::PartitionKey, long>::value, "getPartitionKey is not detected");
+
+	std::atomic<int> processedCount(0);
+	queue.appendListener(1, [&processedCount](int, int) {
+		++processedCount;
+	});
+
+	TemplateParallelPolicies::getCallCount() = 0;
+	for(int i = 0; i < 10; ++i) {
+		queue.enqueue(1, i, i);
+	}
+	queue.processParallel(2);
+	REQUIRE(processedCount.load() == 10);
+	REQUIRE(TemplateParallelPolicies::getCallCount().load() == 10);
+
+	TemplateParallelPolicies::getCallCount() = 0;
+	for(int i = 0; i < 10; ++i) {
+		queue.enqueue(1, i, i);
+	}
+	queue.processPartitioned(2);
+	REQUIRE(processedCount.load() == 20);
+	REQUIRE(TemplateParallelPolicies::getCallCount().load() == 10);
+}
+
+TEST_CASE("queue, MixinStagedEnqueue")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinStagedEnqueue>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+	queue.setStagingCapacity(4);
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	queue.enqueueStaged(3, 1);
+	queue.enqueueStaged(3, 2);
+	queue.enqueueStaged(3, 3);
+	REQUIRE(queue.empty());
+
+	// The buffer is full and published.
+	queue.enqueueStaged(3, 4);
+	REQUIRE(! queue.empty());
+	REQUIRE(queue.processCount(100) == 4);
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4 });
+
+	queue.enqueueStaged(3, 5);
+	REQUIRE(queue.empty());
+	queue.flushStaged();
+	REQUIRE(! queue.empty());
+	queue.enqueueStaged(3, 6);
+	// process publishes the staged events.
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4, 5, 6 });
+
+	queue.enqueueStaged(3, 7);
+	REQUIRE(queue.waitFor(std::chrono::milliseconds(0)));
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4, 5, 6, 7 });
+	REQUIRE(! queue.waitFor(std::chrono::milliseconds(1)));
+
+	// All process functions publish the staged events.
+	queue.enqueueStaged(3, 8);
+	REQUIRE(queue.processOne());
+	queue.enqueueStaged(3, 9);
+	REQUIRE(queue.processCount(100) == 1);
+	queue.enqueueStaged(3, 10);
+	REQUIRE(queue.processFor(std::chrono::seconds(10)) == 1);
+	queue.enqueueStaged(3, 11);
+	REQUIRE(queue.processReady() == 1);
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 });
+}
+
+TEST_CASE("queue, MixinStagedEnqueue, max staging delay")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinStagedEnqueue>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+	queue.setStagingCapacity(100);
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	// Nothing is staged.
+	queue.flushAllStaged();
+	REQUIRE(queue.empty());
+
+	REQUIRE(queue.getMaxStagingDelay() == EQ::Clock::duration::zero());
+	queue.enqueueStaged(3, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	queue.enqueueStaged(3, 2);
+	REQUIRE(queue.empty());
+
+	queue.setMaxStagingDelay(std::chrono::milliseconds(1));
+	REQUIRE(queue.getMaxStagingDelay() == std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	// The oldest staged event is older than the delay, the buffer is published.
+	queue.enqueueStaged(3, 3);
+	REQUIRE(! queue.empty());
+	REQUIRE(queue.processCount(100) == 3);
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3 });
+
+	queue.setMaxStagingDelay(std::chrono::seconds(100));
+	queue.enqueueStaged(3, 4);
+	queue.enqueueStaged(3, 5);
+	REQUIRE(queue.empty());
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4, 5 });
+}
+
+TEST_CASE("queue, MixinStagedEnqueue, MixinParallelProcess")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinStagedEnqueue, eventpp::MixinParallelProcess>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	queue.enqueueStaged(3, 1);
+	queue.processParallel(1);
+	REQUIRE(dataList == std::vector<int>{ 1 });
+
+	queue.enqueueStaged(3, 2);
+	queue.processPartitioned(1, [](std::function<void ()> task) {
+		task();
+	});
+	REQUIRE(dataList == std::vector<int>{ 1, 2 });
+}
+
+TEST_CASE("queue multi threading, MixinStagedEnqueue, wait without polling")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinStagedEnqueue>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	// The staged event is never published by the producer, it wakes up the waiting consumer.
+	std::thread consumer([&queue]() {
+		queue.wait();
+		queue.process();
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	queue.enqueueStaged(3, 1);
+	consumer.join();
+	REQUIRE(dataList == std::vector<int>{ 1 });
+
+	std::thread producer([&queue]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		queue.enqueueStaged(3, 2);
+	});
+	REQUIRE(queue.waitFor(std::chrono::seconds(10)));
+	queue.process();
+	producer.join();
+	REQUIRE(dataList == std::vector<int>{ 1, 2 });
+}
+
+TEST_CASE("queue multi threading, MixinStagedEnqueue")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinStagedEnqueue>;
+	};
+	using EQ = eventpp::EventQueue<int, void (int, int), Policies>;
+	EQ queue;
+	queue.setStagingCapacity(16);
+
+	constexpr int threadCount = 4;
+	constexpr int itemCount = 10001;
+
+	// Only the consumer thread touches dataList.
+	std::vector<std::vector<int> > dataList(threadCount);
+	int processedCount = 0;
+	queue.appendListener(3, [&dataList, &processedCount](const int thread, const int n) {
+		dataList[thread].push_back(n);
+		++processedCount;
+	});
+
+	// The consumer doesn't stop until all events are dispatched, including the ones staged
+	// when the producers exit, which are published by wait.
+	std::thread consumer([&queue, &processedCount]() {
+		while(processedCount < threadCount * itemCount) {
+			queue.wait();
+			queue.process();
+		}
+	});
+
+	std::vector<std::thread> producerList;
+	for(int i = 0; i < threadCount; ++i) {
+		producerList.emplace_back([&queue, i]() {
+			for(int k = 0; k < itemCount; ++k) {
+				queue.enqueueStaged(3, i, k);
+			}
+		});
+	}
+	for(auto & thread : producerList) {
+		thread.join();
+	}
+	consumer.join();
+
+	std::vector<int> expectedList(itemCount);
+	std::iota(expectedList.begin(), expectedList.end(), 0);
+	for(int i = 0; i < threadCount; ++i) {
+		REQUIRE(dataList[i] == expectedList);
+	}
+}
+
+TEST_CASE("queue, MixinRecorder")
+{
+	struct Policies
+	{
+		using Mixins = eventpp::MixinList<eventpp::MixinRecorder>;
+
+		static void serializeEvent(std::string & data, const int & e, const int & n) {
+			data.append(reinterpret_cast<const char *>(&e), sizeof(e));
+			data.append(reinterpret_cast<const char *>(&n), sizeof(n));
+		}
+
+		static bool deserializeEvent(const char * data, const std::size_t size, int & e, int & n) {
+			if(size != sizeof(e) + sizeof(n)) {
+				return false;
+			}
+			std::memcpy(&e, data, sizeof(e));
+			std::memcpy(&n, data + sizeof(e), sizeof(n));
+			return true;
+		}
+	};
+	using EQ = eventpp::EventQueue<int, void (int), Policies>;
+	const std::string fileName = "eventpp_test_queue_recording.bin";
+
+	{
+		EQ queue;
+		REQUIRE(queue.startRecording(fileName));
+		for(int i = 0; i < 100; ++i) {
+			queue.enqueue(i % 3, i);
+		}
+		// The events are recorded when they are dispatched.
+		REQUIRE(queue.getRecordedCount() == 0);
+		queue.process();
+		REQUIRE(queue.getRecordedCount() == 100);
+	}
+
+	// Feed the recording to a queue.
+	EQ queue;
+	std::vector<int> dataList;
+	queue.appendListener(1, [&dataList](const int n) {
+		dataList.push_back(n);
+	});
+	REQUIRE(EQ::readRecording(fileName, eventpp::ReplayPace::fastest, [&queue](EQ::RecordedEvent & recordedEvent) {
+		queue.enqueue(std::get<0>(recordedEvent), std::get<1>(recordedEvent));
+	}) == 100);
+	queue.process();
+
+	std::vector<int> expectedList;
+	for(int i = 1; i < 100; i += 3) {
+		expectedList.push_back(i);
+	}
+	REQUIRE(dataList == expectedList);
+	std::remove(fileName.c_str());
+}
+
+#if defined(EVENTPP_TEST_JOURNAL)
+namespace {
+
+struct JournalPolicies
+{
+	using Mixins = eventpp::MixinList<eventpp::MixinJournal>;
+
+	static void serializeEvent(std::string & data, const int & e, const int & n, const std::string & s) {
+		data.append(reinterpret_cast<const char *>(&e), sizeof(e));
+		data.append(reinterpret_cast<const char *>(&n), sizeof(n));
+		data.append(s);
+	}
+
+	static bool deserializeEvent(const char * data, const std::size_t size, int & e, int & n, std::string & s) {
+		if(size < sizeof(e) + sizeof(n)) {
+			return false;
+		}
+		std::memcpy(&e, data, sizeof(e));
+		std::memcpy(&n, data + sizeof(e), sizeof(n));
+		s.assign(data + sizeof(e) + sizeof(n), size - sizeof(e) - sizeof(n));
+		return true;
+	}
+};
+
+struct RingJournalPolicies : JournalPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::RingQueueList<2, eventpp::RingOverflow::dropNewest>::QueueList<Item, Policies>;
+};
+
+struct ParallelJournalPolicies : JournalPolicies
+{
+	using Mixins = eventpp::MixinList<eventpp::MixinJournal, eventpp::MixinParallelProcess>;
+};
+
+using JournalQueue = eventpp::EventQueue<int, void (int, const std::string &), JournalPolicies>;
+
+struct JournalDirectory
+{
+	JournalDirectory() {
+		char pattern[] = "/tmp/eventpp_journal_XXXXXX";
+		path = ::mkdtemp(pattern);
+	}
+
+	~JournalDirectory() {
+		const std::string command = "rm -rf " + path;
+		REQUIRE(std::system(command.c_str()) == 0);
+	}
+
+	std::string getPrefix() const {
+		return path + "/queue";
+	}
+
+	std::string path;
+};
+
+} //unnamed namespace
+
+TEST_CASE("queue, MixinJournal, recover the events which are not processed")
+{
+	JournalDirectory directory;
+
+	std::vector<int> dataList;
+	auto listener = [&dataList](const int n, const std::string & s) {
+		REQUIRE(s == std::to_string(n));
+		dataList.push_back(n);
+	};
+
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		REQUIRE(queue.recoverJournal() == 0);
+		queue.appendListener(3, listener);
+
+		for(int i = 0; i < 5; ++i) {
+			queue.enqueue(3, i, std::to_string(i));
+		}
+		queue.process();
+		REQUIRE(dataList == std::vector<int>({ 0, 1, 2, 3, 4 }));
+
+		for(int i = 5; i < 8; ++i) {
+			queue.enqueue(3, i, std::to_string(i));
+		}
+		// Simulate a crash, the queue is destroyed without processing.
+	}
+
+	dataList.clear();
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		queue.appendListener(3, listener);
+		REQUIRE(queue.recoverJournal() == 3);
+		queue.enqueue(3, 8, "8");
+		queue.process();
+		REQUIRE(dataList == std::vector<int>({ 5, 6, 7, 8 }));
+		REQUIRE(queue.getJournalErrorCount() == 0);
+	}
+
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		REQUIRE(queue.recoverJournal() == 0);
+	}
+}
+
+TEST_CASE("queue, MixinJournal, partial processing")
+{
+	JournalDirectory directory;
+
+	std::vector<int> dataList;
+	auto listener = [&dataList](const int n, const std::string &) {
+		dataList.push_back(n);
+	};
+
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		queue.appendListener(3, listener);
+
+		for(int i = 0; i < 10; ++i) {
+			queue.enqueue(3, i, std::to_string(i));
+		}
+		REQUIRE(queue.processOne());
+		REQUIRE(queue.processCount(2) == 2);
+		REQUIRE(queue.processFor(std::chrono::seconds(10)) == 7);
+		REQUIRE(dataList == std::vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+
+		for(int i = 10; i < 15; ++i) {
+			queue.enqueue(3, i, std::to_string(i));
+		}
+		REQUIRE(queue.processCount(1) == 1);
+		JournalQueue::QueuedEvent queuedEvent;
+		REQUIRE(queue.takeEvent(&queuedEvent));
+		REQUIRE(std::get<1>(queuedEvent) == 11);
+		// Simulate a crash, the events 12, 13 and 14 are not processed.
+	}
+
+	dataList.clear();
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		queue.appendListener(3, listener);
+		REQUIRE(queue.recoverJournal() == 3);
+		REQUIRE(queue.processCount(1) == 1);
+		REQUIRE(dataList == std::vector<int>({ 12 }));
+	}
+
+	dataList.clear();
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		queue.appendListener(3, listener);
+		REQUIRE(queue.recoverJournal() == 2);
+		queue.process();
+		REQUIRE(dataList == std::vector<int>({ 13, 14 }));
+	}
+
+	{
+		using ParallelQueue = eventpp::EventQueue<int, void (int, const std::string &), ParallelJournalPolicies>;
+		std::atomic<int> count(0);
+		{
+			ParallelQueue queue;
+			REQUIRE(queue.openJournal(directory.getPrefix()));
+			REQUIRE(queue.recoverJournal() == 0);
+			queue.appendListener(3, [&count](int, const std::string &) {
+				++count;
+			});
+			for(int i = 0; i < 8; ++i) {
+				queue.enqueue(3, i, std::to_string(i));
+			}
+			queue.processParallel(2);
+			queue.enqueue(3, 8, "8");
+		}
+		REQUIRE(count.load() == 8);
+
+		ParallelQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		REQUIRE(queue.recoverJournal() == 1);
+	}
+}
+
+TEST_CASE("queue, MixinJournal, segments")
+{
+	JournalDirectory directory;
+
+	constexpr int itemCount = 1000;
+	std::vector<int> dataList;
+
+	{
+		JournalQueue queue;
+		// Each entry takes 40 bytes, so there are many segments.
+		REQUIRE(queue.openJournal(directory.getPrefix(), 1024));
+		queue.setJournalSync(eventpp::JournalSync::async, 100);
+		queue.appendListener(3, [&dataList](const int n, const std::string &) {
+			dataList.push_back(n);
+		});
+
+		for(int i = 0; i < itemCount; ++i) {
+			queue.enqueue(3, i, "abcdefghijkl");
+			if(i == itemCount / 2) {
+				queue.process();
+			}
+		}
+		queue.syncJournal();
+	}
+	REQUIRE((int)dataList.size() == itemCount / 2 + 1);
+
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix(), 1024));
+		queue.appendListener(3, [&dataList](const int n, const std::string & s) {
+			REQUIRE(s == "abcdefghijkl");
+			dataList.push_back(n);
+		});
+		REQUIRE(queue.recoverJournal() == itemCount / 2 - 1);
+		queue.process();
+	}
+
+	std::vector<int> expectedList(itemCount);
+	std::iota(expectedList.begin(), expectedList.end(), 0);
+	REQUIRE(dataList == expectedList);
+}
+
+// A torn entry in a segment followed by other segments, the recovery stops at the gap.
+TEST_CASE("queue, MixinJournal, recovery stops at missing entry")
+{
+	JournalDirectory directory;
+
+	{
+		JournalQueue queue;
+		// Each entry takes 40 bytes, a segment has 24 entries.
+		REQUIRE(queue.openJournal(directory.getPrefix(), 1024));
+		queue.setJournalSync(eventpp::JournalSync::async, 100);
+		for(int i = 1; i <= 100; ++i) {
+			queue.enqueue(3, i, "abcdefghijkl");
+		}
+	}
+
+	// Corrupt the payload of the 5th entry in the first segment.
+	{
+		const std::string path = directory.getPrefix() + ".0000000000";
+		FILE * file = std::fopen(path.c_str(), "r+b");
+		REQUIRE(file != nullptr);
+		std::fseek(file, 64 + 40 * 4 + 16, SEEK_SET);
+		std::fputc('x', file);
+		std::fclose(file);
+	}
+
+	std::vector<int> dataList;
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix(), 1024));
+		queue.appendListener(3, [&dataList](const int n, const std::string &) {
+			dataList.push_back(n);
+		});
+		REQUIRE(queue.recoverJournal() == 4);
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4 });
+
+		// The new events get the sequences after the greatest one in the journal.
+		queue.enqueue(3, 200, "abcdefghijkl");
+	}
+
+	{
+		JournalQueue queue;
+		REQUIRE(queue.openJournal(directory.getPrefix(), 1024));
+		queue.appendListener(3, [&dataList](const int n, const std::string &) {
+			dataList.push_back(n);
+		});
+		// The consumed sequence is 4, the next entry is still missing.
+		REQUIRE(queue.recoverJournal() == 0);
+	}
+}
+
+TEST_CASE("queue, MixinJournal, torn entry and rejected event")
+{
+	JournalDirectory directory;
+
+	{
+		using EQ = eventpp::EventQueue<int, void (int, const std::string &), RingJournalPolicies>;
+		EQ queue;
+		REQUIRE(queue.openJournal(directory.getPrefix()));
+		REQUIRE(queue.tryEnqueue(3, 1, "a"));
+		REQUIRE(queue.tryEnqueue(3, 2, "b"));
+		// The ring is full, the rejected event is removed from the journal.
+		REQUIRE(! queue.tryEnqueue(3, 3, "c"));
+		queue.syncJournal();
+	}
+
+	// Corrupt the payload of the second entry.
+	{
+		const std::string path = directory.getPrefix() + ".0000000000";
+		FILE * file = std::fopen(path.c_str(), "r+b");
+		REQUIRE(file != nullptr);
+		// segment header (64) + first entry (16 + 12 -> 32) + entry header (16)
+		std::fseek(file, 64 + 32 + 16, SEEK_SET);
+		std::fputc('x', file);
+		std::fclose(file);
+	}
+
+	std::vector<int> dataList;
+	JournalQueue queue;
+	REQUIRE(queue.openJournal(directory.getPrefix()));
+	queue.appendListener(3, [&dataList](const int n, const std::string &) {
+		dataList.push_back(n);
+	});
+	REQUIRE(queue.recoverJournal() == 1);
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1 });
+}
+#endif
@@ -0,0 +1,1558 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "test.h"
+#include "eventpp/eventqueue.h"
+#include "eventpp/queuelists/mpscqueuelist.h"
+#include "eventpp/queuelists/ringqueuelist.h"
+#include "eventpp/queuelists/chunkqueuelist.h"
+#include "eventpp/queuelists/priorityqueuelist.h"
+#include "eventpp/queuelists/coalescingqueuelist.h"
+#include "eventpp/queuelists/spscqueuelist.h"
+#include "eventpp/queuelists/latencyqueuelist.h"
+#include "eventpp/queuelists/arenaqueuelist.h"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <condition_variable>
+
+namespace {
+
+struct MpscPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::MpscQueueList<Item, Policies>;
+};
+
+// An atomic which calls a hook when the consumer has seen a node without next and then reads the tail,
+// which is the window between checking the tail and pushing the stub in MpscQueueList.
+std::function<void ()> tailCheckHook;
+
+template <typename T>
+struct HookedAtomic : std::atomic<T>
+{
+	using std::atomic<T>::atomic;
+	using std::atomic<T>::operator =;
+};
+
+template <typename T>
+struct HookedAtomic <T *> : std::atomic<T *>
+{
+	using std::atomic<T *>::atomic;
+	using std::atomic<T *>::operator =;
+
+	T * load(const std::memory_order order = std::memory_order_seq_cst) const
+	{
+		T * value = std::atomic<T *>::load(order);
+		if(this == getTailAddress() && getLastLoadIsNull() && tailCheckHook) {
+			std::function<void ()> hook;
+			hook.swap(tailCheckHook);
+			hook();
+		}
+		getLastLoadIsNull() = (value == nullptr);
+		return value;
+	}
+
+	T * exchange(T * desired, const std::memory_order order = std::memory_order_seq_cst)
+	{
+		// The tail is the only atomic which is exchanged with a non null node.
+		if(desired != nullptr) {
+			getTailAddress() = this;
+		}
+		return std::atomic<T *>::exchange(desired, order);
+	}
+
+	static const void *& getTailAddress() {
+		static const void * tailAddress = nullptr;
+		return tailAddress;
+	}
+
+	static bool & getLastLoadIsNull() {
+		static bool lastLoadIsNull = false;
+		return lastLoadIsNull;
+	}
+};
+
+struct HookedMpscPolicies
+{
+	struct Threading
+	{
+		using Mutex = std::mutex;
+
+		template <typename T>
+		using Atomic = HookedAtomic<T>;
+
+		using ConditionVariable = std::condition_variable;
+	};
+
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::MpscQueueList<Item, Policies>;
+};
+
+template <std::size_t Capacity, eventpp::RingOverflow Overflow>
+struct RingPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = typename eventpp::RingQueueList<Capacity, Overflow>::template QueueList<Item, Policies>;
+};
+
+template <std::size_t Capacity, eventpp::RingOverflow Overflow>
+struct SingleThreadingRingPolicies
+{
+	using Threading = eventpp::SingleThreading;
+
+	template <typename Item, typename Policies>
+	using QueueList = typename eventpp::RingQueueList<Capacity, Overflow>::template QueueList<Item, Policies>;
+};
+
+// Small chunks to test crossing the chunk boundaries.
+struct ChunkPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = typename eventpp::ChunkQueueList<sizeof(Item) * 3>::template QueueList<Item, Policies>;
+};
+
+// The priority is the first argument, the second argument is the data.
+struct HeapPriorityPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::PriorityQueueList<Item, Policies>;
+
+	static int getPriority(const int /*e*/, const int priority, const int /*data*/) {
+		return priority;
+	}
+};
+
+struct LanePriorityPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::LanePriorityQueueList<3>::QueueList<Item, Policies>;
+
+	static int getPriority(const int /*e*/, const int priority, const int /*data*/) {
+		return priority;
+	}
+};
+
+struct CoalescingPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::CoalescingQueueList<Item, Policies>;
+};
+
+// The key is the first argument, the second argument is the data.
+struct KeyCoalescingPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::CoalescingQueueList<Item, Policies>;
+
+	static int getCoalescingKey(const int /*e*/, const int key, const std::string & /*data*/) {
+		return key;
+	}
+};
+
+// Same as KeyCoalescingPolicies, but the function is a template, the key is the first argument.
+struct TemplateKeyCoalescingPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::CoalescingQueueList<Item, Policies>;
+
+	template <typename E, typename K, typename ...A>
+	static K getCoalescingKey(const E & /*e*/, const K & key, const A & ...) {
+		return key;
+	}
+};
+
+template <std::size_t Capacity>
+struct SpscPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = typename eventpp::SpscQueueList<Capacity>::template QueueList<Item, Policies>;
+};
+
+struct MaxFreePolicies
+{
+	static constexpr std::size_t maxFreeItemCount = 8;
+};
+
+// Small chunks to test crossing the chunk boundaries and the records larger than a chunk.
+struct ArenaPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::ArenaQueueList<256>::QueueList<Item, Policies>;
+};
+
+struct LatencyPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::LatencyQueueList<>::QueueList<Item, Policies>;
+};
+
+struct LatencyMpscPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::LatencyQueueList<eventpp::MpscQueueList>::QueueList<Item, Policies>;
+};
+
+struct LatencyPriorityPolicies : HeapPriorityPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::LatencyQueueList<eventpp::PriorityQueueList>::QueueList<Item, Policies>;
+};
+
+struct LatencyRingPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::LatencyQueueList<eventpp::RingQueueList<2, eventpp::RingOverflow::overwriteOldest>::QueueList>::QueueList<Item, Policies>;
+};
+
+struct LatencyCoalescingPolicies : KeyCoalescingPolicies
+{
+	template <typename Item, typename Policies>
+	using QueueList = eventpp::LatencyQueueList<eventpp::CoalescingQueueList>::QueueList<Item, Policies>;
+};
+
+} //unnamed namespace
+
+TEST_CASE("queue list, MpscQueueList, process in order")
+{
+	eventpp::EventQueue<int, void (int, int), MpscPolicies> queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	REQUIRE(queue.empty());
+
+	for(int i = 0; i < 5; ++i) {
+		queue.enqueue(3, i);
+	}
+	REQUIRE(! queue.empty());
+
+	queue.process();
+	REQUIRE(queue.empty());
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 4 });
+
+	// The nodes are reused.
+	queue.enqueue(3, 5);
+	queue.enqueue(3, 6);
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6 });
+}
+
+TEST_CASE("queue list, MpscQueueList, enqueue in listener")
+{
+	eventpp::EventQueue<int, void (int, int), MpscPolicies> queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList, &queue](int, const int n) {
+		dataList.push_back(n);
+		if(n < 3) {
+			queue.enqueue(3, n + 1);
+		}
+	});
+
+	queue.enqueue(3, 0);
+	queue.enqueue(3, 1);
+
+	// The events enqueued during processing are processed in the next process().
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1 });
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 1, 2 });
+}
+
+TEST_CASE("queue list, MpscQueueList, peekEvent/takeEvent")
+{
+	using SP = std::shared_ptr<int>;
+	using WP = std::weak_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (SP), MpscPolicies>;
+
+	std::unique_ptr<EQ> queue(new EQ());
+	std::vector<WP> wpList;
+	for(int i = 0; i < 3; ++i) {
+		SP sp(std::make_shared<int>(i));
+		queue->enqueue(3, sp);
+		wpList.push_back(WP(sp));
+	}
+
+	EQ::QueuedEvent event;
+	REQUIRE(queue->peekEvent(&event));
+	REQUIRE(*std::get<1>(event) == 0);
+	REQUIRE(wpList[0].use_count() == 2);
+
+	EQ::QueuedEvent event2;
+	REQUIRE(queue->takeEvent(&event2));
+	REQUIRE(*std::get<1>(event2) == 0);
+	REQUIRE(wpList[0].use_count() == 2);
+
+	REQUIRE(queue->peekEvent(&event));
+	REQUIRE(*std::get<1>(event) == 1);
+
+	REQUIRE(queue->takeEvent(&event2));
+	REQUIRE(queue->takeEvent(&event2));
+	REQUIRE(*std::get<1>(event2) == 2);
+	REQUIRE(! queue->takeEvent(&event2));
+	REQUIRE(! queue->peekEvent(&event2));
+	REQUIRE(queue->empty());
+
+	SP sp(std::make_shared<int>(5));
+	queue->enqueue(3, sp);
+	wpList.push_back(WP(sp));
+	sp.reset();
+
+	// The queued arguments are freed with the queue.
+	event = EQ::QueuedEvent();
+	event2 = EQ::QueuedEvent();
+	queue.reset();
+	for(const auto & wp : wpList) {
+		REQUIRE(wp.expired());
+	}
+}
+
+TEST_CASE("queue list, MpscQueueList, reuse more nodes than the node cache")
+{
+	using EQ = eventpp::EventQueue<int, void (int), MpscPolicies>;
+	EQ queue1;
+	EQ queue2;
+
+	std::vector<int> dataList;
+	queue1.appendListener(1, [&dataList](const int n) {
+		dataList.push_back(n);
+	});
+	queue2.appendListener(2, [&dataList](const int n) {
+		dataList.push_back(-n);
+	});
+
+	const int itemCount = 300;
+	std::vector<int> expectedList;
+	for(int round = 0; round < 3; ++round) {
+		dataList.clear();
+		expectedList.clear();
+		for(int i = 0; i < itemCount; ++i) {
+			queue1.enqueue(1, i);
+			queue2.enqueue(2, i);
+			expectedList.push_back(i);
+		}
+		queue1.process();
+		for(int i = 0; i < itemCount; ++i) {
+			expectedList.push_back(-i);
+		}
+		queue2.process();
+		REQUIRE(dataList == expectedList);
+	}
+}
+
+TEST_CASE("queue list, MpscQueueList, listener throws")
+{
+	using SP = std::shared_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (SP), MpscPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](const SP & sp) {
+		if(*sp == 1) {
+			throw std::runtime_error("listener");
+		}
+		dataList.push_back(*sp);
+	});
+
+	std::vector<std::weak_ptr<int> > wpList;
+	for(int i = 0; i < 4; ++i) {
+		SP sp(std::make_shared<int>(i));
+		wpList.push_back(sp);
+		queue.enqueue(3, std::move(sp));
+	}
+	REQUIRE_THROWS(queue.process());
+	REQUIRE(dataList == std::vector<int>{ 0 });
+	// The rest of the detached nodes are destroyed and reused.
+	for(const auto & wp : wpList) {
+		REQUIRE(wp.expired());
+	}
+	REQUIRE(queue.empty());
+	for(int i = 4; i < 8; ++i) {
+		queue.enqueue(3, std::make_shared<int>(i));
+	}
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 4, 5, 6, 7 });
+}
+
+// A producer pushes between the consumer checking the tail and pushing the stub,
+// the stub is linked after the producer's node, and the node must not be lost.
+TEST_CASE("queue list, MpscQueueList, push while pushing the stub")
+{
+	using EQ = eventpp::EventQueue<int, void (int), HookedMpscPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](const int n) {
+		dataList.push_back(n);
+	});
+
+	queue.enqueue(3, 1);
+	tailCheckHook = [&queue]() {
+		queue.enqueue(3, 2);
+	};
+	queue.process();
+	REQUIRE(! tailCheckHook);
+	REQUIRE(dataList == std::vector<int>{ 1 });
+	REQUIRE(! queue.empty());
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2 });
+	REQUIRE(queue.empty());
+
+	queue.enqueue(3, 3);
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 2, 3 });
+	REQUIRE(queue.empty());
+}
+
+// There is no event enqueued after the producers finish, so an event left in the queue is never dispatched.
+TEST_CASE("queue list, MpscQueueList, multi producers without stop event")
+{
+	using EQ = eventpp::EventQueue<int, void (int), MpscPolicies>;
+	EQ queue;
+
+	constexpr int threadCount = 4;
+	constexpr int dataCountPerThread = 1024 * 16;
+	constexpr int itemCount = threadCount * dataCountPerThread;
+
+	std::atomic<int> processedCount(0);
+	queue.appendListener(3, [&processedCount](int) {
+		++processedCount;
+	});
+
+	std::thread consumer([&queue, &processedCount, itemCount]() {
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while(processedCount.load() < itemCount && std::chrono::steady_clock::now() < deadline) {
+			queue.waitFor(std::chrono::milliseconds(10));
+			queue.process();
+		}
+	});
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([dataCountPerThread, &queue]() {
+			for(int k = 0; k < dataCountPerThread; ++k) {
+				queue.enqueue(3, k);
+				if(k % 2 == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+	consumer.join();
+
+	REQUIRE(processedCount.load() == itemCount);
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("queue list, MpscQueueList, multi producers")
+{
+	using EQ = eventpp::EventQueue<int, void (int), MpscPolicies>;
+	EQ queue;
+
+	constexpr int threadCount = 16;
+	constexpr int dataCountPerThread = 1024 * 16;
+	constexpr int itemCount = threadCount * dataCountPerThread;
+	constexpr int stopEvent = -1;
+
+	std::vector<int> dataList(itemCount);
+	std::vector<int> lastList(threadCount, -1);
+	bool inOrder = true;
+	for(int i = 0; i < threadCount; ++i) {
+		queue.appendListener(i, [i, &dataList, &lastList, &inOrder](const int d) {
+			++dataList[d];
+			// The events from the same producer are processed in order.
+			if(d <= lastList[i]) {
+				inOrder = false;
+			}
+			lastList[i] = d;
+		});
+	}
+
+	std::atomic<bool> shouldStop(false);
+	queue.appendListener(stopEvent, [&shouldStop](int) {
+		shouldStop = true;
+	});
+
+	std::thread consumer([&queue, &shouldStop]() {
+		while(! shouldStop) {
+			queue.wait();
+			queue.process();
+		}
+	});
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([i, dataCountPerThread, &queue]() {
+			for(int k = i * dataCountPerThread; k < (i + 1) * dataCountPerThread; ++k) {
+				queue.enqueue(i, k);
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+
+	queue.enqueue(stopEvent, 0);
+	consumer.join();
+
+	REQUIRE(inOrder);
+	REQUIRE(dataList == std::vector<int>(itemCount, 1));
+}
+
+TEST_CASE("queue list, RingQueueList, fail")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), RingPolicies<4, eventpp::RingOverflow::fail> >;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	REQUIRE(EQ::QueueList::getCapacity() == 4);
+
+	for(int i = 0; i < 6; ++i) {
+		queue.enqueue(3, i);
+	}
+	REQUIRE(queue.getQueueList().size() == 4);
+	REQUIRE(queue.getQueueList().getDroppedCount() == 2);
+
+	REQUIRE(! queue.tryEnqueue(3, 6));
+	REQUIRE(queue.getQueueList().getDroppedCount() == 2);
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3 });
+	REQUIRE(queue.empty());
+
+	// The slots are reused after dispatching.
+	REQUIRE(queue.tryEnqueue(3, 7));
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 7 });
+}
+
+TEST_CASE("queue list, RingQueueList, dropNewest")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), RingPolicies<2, eventpp::RingOverflow::dropNewest> >;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	REQUIRE(queue.tryEnqueue(3, 0));
+	queue.enqueue(3, 1);
+	REQUIRE(! queue.tryEnqueue(3, 2));
+	queue.enqueue(3, 3);
+	REQUIRE(queue.getQueueList().getDroppedCount() == 2);
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1 });
+}
+
+TEST_CASE("queue list, RingQueueList, overwriteOldest")
+{
+	using SP = std::shared_ptr<int>;
+	using WP = std::weak_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (SP), RingPolicies<4, eventpp::RingOverflow::overwriteOldest> >;
+	std::unique_ptr<EQ> queue(new EQ());
+
+	std::vector<int> dataList;
+	queue->appendListener(3, [&dataList](const SP & sp) {
+		dataList.push_back(*sp);
+	});
+
+	std::vector<WP> wpList;
+	for(int i = 0; i < 6; ++i) {
+		SP sp(std::make_shared<int>(i));
+		queue->enqueue(3, sp);
+		wpList.push_back(WP(sp));
+	}
+	REQUIRE(queue->getQueueList().getOverwrittenCount() == 2);
+	REQUIRE(queue->getQueueList().getDroppedCount() == 0);
+	REQUIRE(wpList[0].expired());
+	REQUIRE(wpList[1].expired());
+	REQUIRE(! wpList[2].expired());
+
+	SECTION("process") {
+		queue->process();
+		REQUIRE(dataList == std::vector<int>{ 2, 3, 4, 5 });
+	}
+
+	SECTION("overwrite while dispatching") {
+		// The listener enqueues when the ring is full and all slots are being dispatched,
+		// there is no oldest event to overwrite, so the new event is dropped.
+		bool enqueued = true;
+		queue->appendListener(4, [&queue, &enqueued](const SP &) {
+			enqueued = queue->tryEnqueue(3, std::make_shared<int>(9));
+		});
+		queue->process();
+		for(int i = 0; i < 3; ++i) {
+			queue->enqueue(3, std::make_shared<int>(6 + i));
+		}
+		queue->enqueue(4, SP());
+		queue->process();
+		REQUIRE(! enqueued);
+		REQUIRE(queue->getQueueList().getDroppedCount() == 1);
+		REQUIRE(dataList == std::vector<int>{ 2, 3, 4, 5, 6, 7, 8 });
+	}
+
+	queue.reset();
+	for(const auto & wp : wpList) {
+		REQUIRE(wp.expired());
+	}
+}
+
+TEST_CASE("queue list, RingQueueList, SingleThreading")
+{
+	using FailQueue = eventpp::EventQueue<int, void (int), SingleThreadingRingPolicies<2, eventpp::RingOverflow::fail> >;
+	using DropQueue = eventpp::EventQueue<int, void (int), SingleThreadingRingPolicies<2, eventpp::RingOverflow::dropNewest> >;
+	using OverwriteQueue = eventpp::EventQueue<int, void (int), SingleThreadingRingPolicies<2, eventpp::RingOverflow::overwriteOldest> >;
+
+	std::vector<int> dataList;
+	auto listener = [&dataList](const int n) {
+		dataList.push_back(n);
+	};
+
+	FailQueue failQueue;
+	failQueue.appendListener(1, listener);
+	DropQueue dropQueue;
+	dropQueue.appendListener(2, listener);
+	OverwriteQueue overwriteQueue;
+	overwriteQueue.appendListener(3, listener);
+
+	for(int i = 0; i < 3; ++i) {
+		failQueue.enqueue(1);
+		dropQueue.enqueue(2);
+		overwriteQueue.enqueue(3);
+	}
+	REQUIRE(failQueue.getQueueList().getDroppedCount() == 1);
+	REQUIRE(dropQueue.getQueueList().getDroppedCount() == 1);
+	REQUIRE(overwriteQueue.getQueueList().getOverwrittenCount() == 1);
+
+	failQueue.process();
+	dropQueue.process();
+	overwriteQueue.process();
+	REQUIRE(dataList == std::vector<int>{ 1, 1, 2, 2, 3, 3 });
+}
+
+TEST_CASE("queue list, RingQueueList, listener throws")
+{
+	using SP = std::shared_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (SP), RingPolicies<4, eventpp::RingOverflow::fail> >;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](const SP & sp) {
+		if(*sp == 1) {
+			throw std::runtime_error("listener");
+		}
+		dataList.push_back(*sp);
+	});
+
+	std::vector<std::weak_ptr<int> > wpList;
+	for(int i = 0; i < 4; ++i) {
+		SP sp(std::make_shared<int>(i));
+		wpList.push_back(sp);
+		queue.enqueue(3, std::move(sp));
+	}
+	REQUIRE_THROWS(queue.process());
+	REQUIRE(dataList == std::vector<int>{ 0 });
+	// The rest of the batch is destroyed, and the slots are freed.
+	for(const auto & wp : wpList) {
+		REQUIRE(wp.expired());
+	}
+	REQUIRE(queue.empty());
+	for(int i = 4; i < 8; ++i) {
+		REQUIRE(queue.tryEnqueue(3, std::make_shared<int>(i)));
+	}
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 4, 5, 6, 7 });
+	REQUIRE(queue.getQueueList().getDroppedCount() == 0);
+}
+
+TEST_CASE("queue list, RingQueueList, block")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), RingPolicies<4, eventpp::RingOverflow::block> >;
+	EQ queue;
+
+	constexpr int itemCount = 1024;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int n) {
+		dataList.push_back(n);
+	});
+
+	for(int i = 0; i < 4; ++i) {
+		queue.enqueue(3, i);
+	}
+	REQUIRE(! queue.tryEnqueue(3, 4));
+	REQUIRE(queue.getQueueList().getDroppedCount() == 0);
+
+	std::thread producer([&queue, itemCount]() {
+		for(int i = 4; i < itemCount; ++i) {
+			queue.enqueue(3, i);
+		}
+	});
+
+	while(dataList.size() < (std::size_t)itemCount) {
+		queue.waitFor(std::chrono::milliseconds(10));
+		queue.process();
+	}
+	producer.join();
+
+	std::vector<int> compareList(itemCount);
+	for(int i = 0; i < itemCount; ++i) {
+		compareList[i] = i;
+	}
+	REQUIRE(dataList == compareList);
+	REQUIRE(queue.getQueueList().getDroppedCount() == 0);
+}
+
+TEST_CASE("queue list, RingQueueList, block, enqueue in listener")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), RingPolicies<4, eventpp::RingOverflow::block> >;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList, &queue](int, const int n) {
+		dataList.push_back(n);
+		// All slots are being dispatched, blocking would never return, so the event is dropped.
+		if(n == 0) {
+			queue.enqueue(3, 100);
+		}
+	});
+
+	for(int i = 0; i < 4; ++i) {
+		queue.enqueue(3, i);
+	}
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3 });
+	REQUIRE(queue.getQueueList().getDroppedCount() == 1);
+	REQUIRE(queue.empty());
+
+	// The ring is not full, so the listener can enqueue.
+	queue.enqueue(3, 0);
+	queue.process();
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 0, 100 });
+	REQUIRE(queue.getQueueList().getDroppedCount() == 1);
+}
+
+TEST_CASE("queue list, ChunkQueueList, process in order")
+{
+	eventpp::EventQueue<int, void (int, int), ChunkPolicies> queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList, &queue](int, const int n) {
+		dataList.push_back(n);
+		// Enqueuing during processing writes to the chunks which are not being dispatched.
+		if(n == 1) {
+			queue.enqueue(3, 100);
+		}
+	});
+
+	for(int i = 0; i < 8; ++i) {
+		queue.enqueue(3, i);
+	}
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7 });
+	REQUIRE(! queue.empty());
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 100 });
+	REQUIRE(queue.empty());
+
+	// The chunks are reused.
+	for(int i = 0; i < 4; ++i) {
+		queue.enqueue(3, 200 + i);
+	}
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 100, 200, 201, 202, 203 });
+}
+
+TEST_CASE("queue list, ChunkQueueList, peekEvent/takeEvent")
+{
+	using SP = std::shared_ptr<int>;
+	using WP = std::weak_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (SP), ChunkPolicies>;
+
+	std::unique_ptr<EQ> queue(new EQ());
+	std::vector<int> dataList;
+	queue->appendListener(3, [&dataList](const SP & sp) {
+		dataList.push_back(*sp);
+	});
+
+	std::vector<WP> wpList;
+	for(int i = 0; i < 7; ++i) {
+		SP sp(std::make_shared<int>(i));
+		queue->enqueue(3, sp);
+		wpList.push_back(WP(sp));
+	}
+
+	EQ::QueuedEvent event;
+	for(int i = 0; i < 4; ++i) {
+		REQUIRE(queue->peekEvent(&event));
+		REQUIRE(*std::get<1>(event) == i);
+		REQUIRE(queue->takeEvent(&event));
+		REQUIRE(*std::get<1>(event) == i);
+	}
+	event = EQ::QueuedEvent();
+	for(int i = 0; i < 4; ++i) {
+		REQUIRE(wpList[i].expired());
+	}
+
+	SECTION("process") {
+		queue->process();
+		REQUIRE(dataList == std::vector<int>{ 4, 5, 6 });
+		REQUIRE(! queue->takeEvent(&event));
+	}
+
+	SECTION("destroy") {
+	}
+
+	queue.reset();
+	for(const auto & wp : wpList) {
+		REQUIRE(wp.expired());
+	}
+}
+
+TEST_CASE("queue list, ChunkQueueList, multi threading")
+{
+	using EQ = eventpp::EventQueue<int, void (int), ChunkPolicies>;
+	EQ queue;
+
+	constexpr int threadCount = 16;
+	constexpr int dataCountPerThread = 1024 * 4;
+	constexpr int itemCount = threadCount * dataCountPerThread;
+
+	std::vector<std::atomic<int> > dataList(itemCount);
+	for(int i = 0; i < threadCount; ++i) {
+		queue.appendListener(i, [&dataList](const int d) {
+			++dataList[d];
+		});
+	}
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([i, dataCountPerThread, &queue]() {
+			for(int k = i * dataCountPerThread; k < (i + 1) * dataCountPerThread; ++k) {
+				queue.enqueue(i, k);
+				if(k % 3 == 0) {
+					queue.process();
+				}
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+	queue.process();
+
+	int wrongCount = 0;
+	for(const auto & data : dataList) {
+		if(data.load() != 1) {
+			++wrongCount;
+		}
+	}
+	REQUIRE(wrongCount == 0);
+}
+
+TEST_CASE("queue list, ArenaQueueList, process in order")
+{
+	using EQ = eventpp::EventQueue<int, void (int, const eventpp::ByteView &), ArenaPolicies>;
+	EQ queue;
+
+	std::vector<std::string> dataList;
+	queue.appendListener(3, [&dataList, &queue](const int n, const eventpp::ByteView & bytes) {
+		dataList.push_back(std::to_string(n) + ":" + bytes.toString());
+		// Enqueuing during processing writes to the chunks which are not being dispatched.
+		if(n == 1) {
+			queue.enqueue(3, 100, "x");
+		}
+	});
+
+	std::vector<std::string> expectedList;
+	for(int i = 0; i < 8; ++i) {
+		// The source bytes are gone after enqueue, the bytes are copied into the arena.
+		// The records of 300 and 600 bytes are larger than a chunk.
+		const std::string text(i * 100, (char)('a' + i));
+		queue.enqueue(3, i, text);
+		expectedList.push_back(std::to_string(i) + ":" + text);
+	}
+	queue.enqueue(3, 8, eventpp::ByteView());
+	expectedList.push_back("8:");
+
+	queue.process();
+	REQUIRE(dataList == expectedList);
+	REQUIRE(! queue.empty());
+
+	queue.process();
+	expectedList.push_back("100:x");
+	REQUIRE(dataList == expectedList);
+	REQUIRE(queue.empty());
+
+	// The chunks are reused, the chunks larger than ChunkBytes are freed.
+	std::size_t allocatedSize = 0;
+	for(int round = 0; round < 10; ++round) {
+		for(int i = 0; i < 8; ++i) {
+			queue.enqueue(3, 200 + i, std::string(50, 'y'));
+		}
+		queue.process();
+		if(round == 1) {
+			// The chunks retired in a process are recycled in the next process.
+			allocatedSize = queue.getQueueList().getAllocatedSize();
+		}
+	}
+	REQUIRE(dataList.size() == expectedList.size() + 80);
+	REQUIRE(dataList.back() == "207:" + std::string(50, 'y'));
+	REQUIRE(queue.getQueueList().getAllocatedSize() == allocatedSize);
+}
+
+TEST_CASE("queue list, ArenaQueueList, peekEvent/takeEvent")
+{
+	using EQ = eventpp::EventQueue<int, void (int, eventpp::ByteView), ArenaPolicies>;
+	EQ queue;
+
+	std::vector<std::string> dataList;
+	queue.appendListener(3, [&dataList](int, const eventpp::ByteView & bytes) {
+		dataList.push_back(bytes.toString());
+	});
+
+	for(int i = 0; i < 7; ++i) {
+		queue.enqueue(3, i, std::string(40, (char)('a' + i)));
+	}
+
+	EQ::QueuedEvent event;
+	for(int i = 0; i < 3; ++i) {
+		REQUIRE(queue.peekEvent(&event));
+		REQUIRE(std::get<1>(event) == i);
+		REQUIRE(std::get<2>(event) == eventpp::ByteView(std::string(40, (char)('a' + i))));
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<1>(event) == i);
+		REQUIRE(std::get<2>(event).toString() == std::string(40, (char)('a' + i)));
+	}
+
+	REQUIRE(queue.processOne());
+	REQUIRE(dataList == std::vector<std::string>{ std::string(40, 'd') });
+	queue.process();
+	REQUIRE(dataList.size() == 4);
+	REQUIRE(dataList.back() == std::string(40, 'g'));
+	REQUIRE(! queue.takeEvent(&event));
+}
+
+TEST_CASE("queue list, ArenaQueueList, multi threading")
+{
+	using EQ = eventpp::EventQueue<int, void (int, eventpp::ByteView), ArenaPolicies>;
+	EQ queue;
+
+	constexpr int threadCount = 8;
+	constexpr int dataCountPerThread = 1024 * 2;
+	constexpr int itemCount = threadCount * dataCountPerThread;
+
+	std::vector<std::atomic<int> > dataList(itemCount);
+	std::atomic<int> wrongBytesCount(0);
+	for(int i = 0; i < threadCount; ++i) {
+		queue.appendListener(i, [&dataList, &wrongBytesCount](const int d, const eventpp::ByteView & bytes) {
+			++dataList[d];
+			if(bytes.toString() != std::string(d % 300, (char)('a' + d % 26))) {
+				++wrongBytesCount;
+			}
+		});
+	}
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([i, dataCountPerThread, &queue]() {
+			for(int k = i * dataCountPerThread; k < (i + 1) * dataCountPerThread; ++k) {
+				queue.enqueue(i, k, std::string(k % 300, (char)('a' + k % 26)));
+				if(k % 3 == 0) {
+					queue.process();
+				}
+				else if(k % 7 == 0) {
+					queue.processCount(2);
+				}
+			}
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+	queue.process();
+
+	int wrongCount = 0;
+	for(const auto & data : dataList) {
+		if(data.load() != 1) {
+			++wrongCount;
+		}
+	}
+	REQUIRE(wrongCount == 0);
+	REQUIRE(wrongBytesCount.load() == 0);
+}
+
+TEST_CASE("queue list, PriorityQueueList")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), HeapPriorityPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList, &queue](int, const int data) {
+		dataList.push_back(data);
+		// Enqueued during processing, it's not dispatched in current process() even though the priority is high.
+		if(data == 4) {
+			queue.enqueue(3, 2, 100);
+		}
+	});
+
+	queue.enqueue(3, 0, 1);
+	queue.enqueue(3, 1, 2);
+	queue.enqueue(3, 2, 3);
+	queue.enqueue(3, 0, 4);
+	queue.enqueue(3, 2, 5);
+	queue.enqueue(3, 1, 6);
+
+	EQ::QueuedEvent event;
+	REQUIRE(queue.peekEvent(&event));
+	REQUIRE(std::get<2>(event) == 3);
+
+	SECTION("process") {
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 3, 5, 2, 6, 1, 4 });
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 3, 5, 2, 6, 1, 4, 100 });
+	}
+
+	SECTION("takeEvent") {
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<2>(event) == 3);
+		// A higher priority event jumps ahead of the queued events.
+		queue.enqueue(3, 2, 7);
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<2>(event) == 5);
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<2>(event) == 7);
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 2, 6, 1, 4 });
+	}
+}
+
+TEST_CASE("queue list, LanePriorityQueueList")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), LanePriorityPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList, &queue](int, const int data) {
+		dataList.push_back(data);
+		// Enqueued during processing, it's not dispatched in current process() even though the priority is high.
+		if(data == 4) {
+			queue.enqueue(3, 2, 100);
+		}
+	});
+
+	queue.enqueue(3, 0, 1);
+	queue.enqueue(3, 1, 2);
+	queue.enqueue(3, 2, 3);
+	queue.enqueue(3, 0, 4);
+	queue.enqueue(3, 2, 5);
+	queue.enqueue(3, 1, 6);
+
+	EQ::QueuedEvent event;
+	REQUIRE(queue.peekEvent(&event));
+	REQUIRE(std::get<2>(event) == 3);
+
+	SECTION("process") {
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 3, 5, 2, 6, 1, 4 });
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 3, 5, 2, 6, 1, 4, 100 });
+	}
+
+	SECTION("takeEvent") {
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<2>(event) == 3);
+		// A higher priority event jumps ahead of the queued events.
+		queue.enqueue(3, 2, 7);
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<2>(event) == 5);
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(std::get<2>(event) == 7);
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 2, 6, 1, 4 });
+	}
+}
+
+TEST_CASE("queue list, CoalescingQueueList, default key")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), CoalescingPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	auto listener = [&dataList, &queue](const int e, const int data) {
+		dataList.push_back(e * 100 + data);
+		// Enqueued during processing, it's not coalesced with the event being dispatched.
+		if(data == 5) {
+			queue.enqueue(e, 6);
+		}
+	};
+	queue.appendListener(1, listener);
+	queue.appendListener(2, listener);
+	queue.appendListener(3, listener);
+
+	queue.enqueue(1, 1);
+	queue.enqueue(2, 2);
+	queue.enqueue(1, 3);
+	queue.enqueue(3, 4);
+	queue.enqueue(2, 5);
+
+	REQUIRE(queue.getQueueList().size() == 3);
+	REQUIRE(queue.getQueueList().getCoalescedCount() == 2);
+
+	EQ::QueuedEvent event;
+	REQUIRE(queue.peekEvent(&event));
+	REQUIRE(event == EQ::QueuedEvent(1, 1, 3));
+
+	// The replaced events keep their positions.
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 103, 205, 304 });
+	REQUIRE(queue.getQueueList().size() == 1);
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 103, 205, 304, 206 });
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("queue list, CoalescingQueueList, listener throws")
+{
+	using SP = std::shared_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (int, SP), CoalescingPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const SP & sp) {
+		if(*sp == 3) {
+			throw std::runtime_error("listener");
+		}
+		dataList.push_back(*sp);
+	});
+
+	std::vector<std::weak_ptr<int> > wpList;
+	for(int i = 0; i < 4; ++i) {
+		SP sp(std::make_shared<int>(i));
+		wpList.push_back(sp);
+		queue.enqueue(3, std::move(sp));
+	}
+	REQUIRE(queue.getQueueList().size() == 1);
+	REQUIRE_THROWS(queue.process());
+	REQUIRE(dataList.empty());
+	// The coalesced event is destroyed, and the node is reused.
+	for(const auto & wp : wpList) {
+		REQUIRE(wp.expired());
+	}
+	REQUIRE(queue.empty());
+	queue.enqueue(3, std::make_shared<int>(4));
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 4 });
+}
+
+TEST_CASE("queue list, CoalescingQueueList, template policy key")
+{
+	using EQ = eventpp::EventQueue<int, void (int, const std::string &), TemplateKeyCoalescingPolicies>;
+	EQ queue;
+
+	queue.enqueue(1, 10, "a");
+	queue.enqueue(1, 20, "b");
+	queue.enqueue(1, 10, "c");
+	REQUIRE(queue.getQueueList().size() == 2);
+
+	std::vector<std::string> dataList;
+	queue.appendListener(1, [&dataList](const int key, const std::string & data) {
+		dataList.push_back(std::to_string(key) + data);
+	});
+	queue.process();
+	REQUIRE(dataList == std::vector<std::string>{ "10c", "20b" });
+}
+
+TEST_CASE("queue list, CoalescingQueueList, policy key")
+{
+	using SP = std::shared_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (int, const std::string &), KeyCoalescingPolicies>;
+	EQ queue;
+
+	queue.enqueue(1, 10, "a");
+	queue.enqueue(1, 20, "b");
+	queue.enqueue(2, 10, "c");
+	queue.enqueue(1, 30, "d");
+	queue.enqueue(1, 20, "e");
+	REQUIRE(queue.getQueueList().size() == 3);
+
+	EQ::QueuedEvent event;
+	REQUIRE(queue.takeEvent(&event));
+	REQUIRE(event == EQ::QueuedEvent(2, 10, "c"));
+
+	// Key 10 is not queued any more, the new event is put to the end.
+	queue.enqueue(1, 10, "f");
+
+	std::vector<std::string> dataList;
+	queue.appendListener(1, [&dataList](const int key, const std::string & data) {
+		dataList.push_back(std::to_string(key) + data);
+	});
+	queue.process();
+	REQUIRE(dataList == std::vector<std::string>{ "20e", "30d", "10f" });
+	REQUIRE(queue.getQueueList().getCoalescedCount() == 2);
+
+	// The replaced events are destroyed.
+	using SPEQ = eventpp::EventQueue<int, void (SP), CoalescingPolicies>;
+	std::weak_ptr<int> wp;
+	{
+		SPEQ spQueue;
+		SP sp = std::make_shared<int>(1);
+		wp = sp;
+		spQueue.enqueue(1, std::move(sp));
+		REQUIRE(! wp.expired());
+		spQueue.enqueue(1, std::make_shared<int>(2));
+		REQUIRE(wp.expired());
+		sp = std::make_shared<int>(3);
+		wp = sp;
+		spQueue.enqueue(1, sp);
+	}
+	// The pending events are destroyed with the queue.
+	REQUIRE(wp.expired());
+}
+
+template <typename EQ>
+void testEnqueueBatch(const std::vector<int> & expectedList)
+{
+	EQ queue;
+
+	std::vector<typename EQ::QueuedEvent> eventList;
+	for(int i = 0; i < 20; ++i) {
+		eventList.emplace_back(3, i % 3, i);
+	}
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int data) {
+		dataList.push_back(data);
+	});
+
+	queue.enqueue(3, 0, 100);
+	REQUIRE(queue.enqueueBatch(eventList.begin(), eventList.begin()) == 0);
+	REQUIRE(queue.enqueueBatch(eventList) == eventList.size());
+	queue.enqueue(3, 0, 101);
+	queue.process();
+	// The free nodes and chunks are reused.
+	REQUIRE(queue.enqueueBatch(eventList) == eventList.size());
+	queue.process();
+	REQUIRE(dataList == expectedList);
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("queue list, enqueueBatch")
+{
+	std::vector<int> fifoList { 100 };
+	for(int i = 0; i < 20; ++i) {
+		fifoList.push_back(i);
+	}
+	fifoList.push_back(101);
+	for(int i = 0; i < 20; ++i) {
+		fifoList.push_back(i);
+	}
+
+	SECTION("ListQueueList") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int)> >(fifoList);
+	}
+	SECTION("MpscQueueList") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int), MpscPolicies> >(fifoList);
+	}
+	SECTION("ChunkQueueList") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int), ChunkPolicies> >(fifoList);
+	}
+	SECTION("ArenaQueueList") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int), ArenaPolicies> >(fifoList);
+	}
+	SECTION("PriorityQueueList, without emplaceRange") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int), HeapPriorityPolicies> >(std::vector<int> {
+			2, 5, 8, 11, 14, 17, 1, 4, 7, 10, 13, 16, 19, 100, 0, 3, 6, 9, 12, 15, 18, 101,
+			2, 5, 8, 11, 14, 17, 1, 4, 7, 10, 13, 16, 19, 0, 3, 6, 9, 12, 15, 18
+		});
+	}
+	SECTION("LatencyQueueList") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int), LatencyMpscPolicies> >(fifoList);
+	}
+	SECTION("LatencyQueueList, PriorityQueueList") {
+		testEnqueueBatch<eventpp::EventQueue<int, void (int, int), LatencyPriorityPolicies> >(std::vector<int> {
+			2, 5, 8, 11, 14, 17, 1, 4, 7, 10, 13, 16, 19, 100, 0, 3, 6, 9, 12, 15, 18, 101,
+			2, 5, 8, 11, 14, 17, 1, 4, 7, 10, 13, 16, 19, 0, 3, 6, 9, 12, 15, 18
+		});
+	}
+}
+
+TEST_CASE("queue list, ListQueueList, reserve/shrinkToFit")
+{
+	using EQ = eventpp::EventQueue<int, void (int)>;
+	EQ queue;
+	EQ::QueueList & queueList = queue.getQueueList();
+
+	REQUIRE(queueList.getAllocatedCount() == 0);
+
+	queueList.reserve(10);
+	REQUIRE(queueList.getFreeCount() == 10);
+	REQUIRE(queueList.getAllocatedCount() == 10);
+	queueList.reserve(5);
+	REQUIRE(queueList.getFreeCount() == 10);
+
+	for(int i = 0; i < 15; ++i) {
+		queue.enqueue(3, i);
+	}
+	REQUIRE(queueList.getQueuedCount() == 15);
+	REQUIRE(queueList.getFreeCount() == 0);
+	REQUIRE(queueList.getAllocatedCount() == 15);
+
+	REQUIRE(queue.processCount(4) == 4);
+	REQUIRE(queueList.getQueuedCount() == 11);
+	REQUIRE(queueList.getFreeCount() == 4);
+
+	queue.process();
+	REQUIRE(queueList.getQueuedCount() == 0);
+	REQUIRE(queueList.getFreeCount() == 15);
+	REQUIRE(queueList.getAllocatedCount() == 15);
+
+	queueList.shrinkToFit();
+	REQUIRE(queueList.getFreeCount() == 0);
+	REQUIRE(queueList.getAllocatedCount() == 0);
+
+	queue.enqueue(3, 1);
+	queue.process();
+	REQUIRE(queueList.getAllocatedCount() == 1);
+}
+
+TEST_CASE("queue list, ListQueueList, maxFreeItemCount")
+{
+	using EQ = eventpp::EventQueue<int, void (int), MaxFreePolicies>;
+	EQ queue;
+	EQ::QueueList & queueList = queue.getQueueList();
+
+	queueList.reserve(100);
+	REQUIRE(queueList.getFreeCount() == 8);
+	REQUIRE(queueList.getAllocatedCount() == 8);
+
+	std::vector<EQ::QueuedEvent> eventList;
+	for(int i = 0; i < 20; ++i) {
+		eventList.emplace_back(3, i);
+	}
+	queue.enqueueBatch(eventList);
+	REQUIRE(queueList.getFreeCount() == 0);
+	REQUIRE(queueList.getAllocatedCount() == 20);
+
+	// The spike is over, only maxFreeItemCount items are kept.
+	queue.process();
+	REQUIRE(queueList.getFreeCount() == 8);
+	REQUIRE(queueList.getAllocatedCount() == 8);
+}
+
+TEST_CASE("queue list, SpscQueueList, single thread")
+{
+	using SP = std::shared_ptr<int>;
+	using EQ = eventpp::EventQueue<int, void (SP), SpscPolicies<4> >;
+
+	std::weak_ptr<int> wp;
+	{
+		EQ queue;
+
+		std::vector<int> dataList;
+		queue.appendListener(3, [&dataList](const SP & sp) {
+			dataList.push_back(*sp);
+		});
+
+		for(int i = 0; i < 4; ++i) {
+			REQUIRE(queue.tryEnqueue(3, std::make_shared<int>(i)));
+		}
+		REQUIRE(! queue.tryEnqueue(3, std::make_shared<int>(100)));
+
+		EQ::QueuedEvent event;
+		REQUIRE(queue.peekEvent(&event));
+		REQUIRE(*std::get<1>(event) == 0);
+		REQUIRE(queue.takeEvent(&event));
+		REQUIRE(*std::get<1>(event) == 0);
+
+		REQUIRE(queue.processCount(2) == 2);
+		REQUIRE(dataList == std::vector<int>{ 1, 2 });
+
+		// The indexes wrap around.
+		for(int i = 4; i < 7; ++i) {
+			REQUIRE(queue.tryEnqueue(3, std::make_shared<int>(i)));
+		}
+		REQUIRE(! queue.tryEnqueue(3, std::make_shared<int>(100)));
+		queue.process();
+		REQUIRE(dataList == std::vector<int>{ 1, 2, 3, 4, 5, 6 });
+		REQUIRE(queue.empty());
+
+		SP sp = std::make_shared<int>(7);
+		wp = sp;
+		queue.enqueue(3, std::move(sp));
+		REQUIRE(! wp.expired());
+	}
+	// The pending events are destroyed with the queue.
+	REQUIRE(wp.expired());
+}
+
+TEST_CASE("queue list, SpscQueueList, one producer one consumer")
+{
+	using EQ = eventpp::EventQueue<int, void (int), SpscPolicies<64> >;
+	EQ queue;
+
+	constexpr int stopEvent = 1;
+	constexpr int otherEvent = 2;
+	constexpr int itemCount = 100000;
+
+	std::vector<int> dataList;
+	bool shouldStop = false;
+	queue.appendListener(stopEvent, [&shouldStop](int) {
+		shouldStop = true;
+	});
+	queue.appendListener(otherEvent, [&dataList](const int n) {
+		dataList.push_back(n);
+	});
+
+	std::thread consumer([&queue, &shouldStop]() {
+		while(! shouldStop) {
+			queue.wait();
+			queue.process();
+		}
+	});
+
+	// The ring is much smaller than itemCount, enqueue waits for the consumer.
+	for(int i = 0; i < itemCount; ++i) {
+		queue.enqueue(otherEvent, i);
+	}
+	queue.enqueue(stopEvent);
+	consumer.join();
+
+	std::vector<int> expectedList(itemCount);
+	for(int i = 0; i < itemCount; ++i) {
+		expectedList[i] = i;
+	}
+	REQUIRE(dataList == expectedList);
+}
+
+TEST_CASE("queue list, LatencyQueueList")
+{
+	using EQ = eventpp::EventQueue<int, void (int, int), LatencyPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](int, const int data) {
+		dataList.push_back(data);
+	});
+
+	for(int i = 0; i < 10; ++i) {
+		queue.enqueue(3, i);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	for(int i = 10; i < 15; ++i) {
+		queue.enqueue(3, i);
+	}
+
+	const auto & queueList = queue.getQueueList();
+	REQUIRE(queueList.getQueuedCount() == 15);
+	REQUIRE(queueList.getMaxQueuedCount() == 15);
+
+	EQ::QueuedEvent event;
+	REQUIRE(queue.peekEvent(&event));
+	REQUIRE(event == EQ::QueuedEvent(3, 3, 0));
+	REQUIRE(queueList.getResidencyHistogram().getCount() == 0);
+
+	REQUIRE(queue.takeEvent(&event));
+	REQUIRE(event == EQ::QueuedEvent(3, 3, 0));
+	queue.process();
+	REQUIRE(dataList.size() == 14);
+	REQUIRE(queueList.getQueuedCount() == 0);
+	REQUIRE(queueList.getMaxQueuedCount() == 15);
+	REQUIRE(queueList.getDispatchedCount() == 15);
+	REQUIRE(queueList.getDispatchRate() > 0);
+
+	const auto & histogram = queueList.getResidencyHistogram();
+	REQUIRE(histogram.getCount() == 15);
+	REQUIRE(histogram.getMax() >= 20 * 1000 * 1000);
+	// The last 5 events are enqueued after sleeping.
+	REQUIRE(histogram.getValueAtPercentile(50) >= 20 * 1000 * 1000);
+
+	queue.getQueueList().resetStatistics();
+	REQUIRE(histogram.getCount() == 0);
+	REQUIRE(queueList.getMaxQueuedCount() == 0);
+	REQUIRE(queueList.getDispatchedCount() == 0);
+	queue.enqueue(3, 100);
+	queue.enqueue(3, 101);
+	REQUIRE(queueList.getMaxQueuedCount() == 2);
+}
+
+TEST_CASE("queue list, LatencyQueueList, wrap CoalescingQueueList")
+{
+	using EQ = eventpp::EventQueue<int, void (int, const std::string &), LatencyCoalescingPolicies>;
+	EQ queue;
+
+	queue.enqueue(1, 10, "a");
+	queue.enqueue(1, 20, "b");
+	queue.enqueue(1, 10, "c");
+	REQUIRE(queue.getQueueList().getInnerQueueList().size() == 2);
+	REQUIRE(queue.getQueueList().getInnerQueueList().getCoalescedCount() == 1);
+	// The replaced event is not counted in the depth.
+	REQUIRE(queue.getQueueList().getQueuedCount() == 2);
+	REQUIRE(queue.getQueueList().getMaxQueuedCount() == 2);
+
+	std::vector<std::string> dataList;
+	queue.appendListener(1, [&dataList](const int key, const std::string & data) {
+		dataList.push_back(std::to_string(key) + data);
+	});
+	queue.process();
+	REQUIRE(dataList == std::vector<std::string>{ "10c", "20b" });
+	REQUIRE(queue.getQueueList().getResidencyHistogram().getCount() == 2);
+	REQUIRE(queue.getQueueList().getQueuedCount() == 0);
+	REQUIRE(queue.getQueueList().getMaxQueuedCount() == 2);
+}
+
+TEST_CASE("queue list, LatencyQueueList, wrap RingQueueList overwriteOldest")
+{
+	using EQ = eventpp::EventQueue<int, void (int), LatencyRingPolicies>;
+	EQ queue;
+
+	std::vector<int> dataList;
+	queue.appendListener(3, [&dataList](const int n) {
+		dataList.push_back(n);
+	});
+
+	for(int i = 0; i < 5; ++i) {
+		queue.enqueue(3, i);
+	}
+	REQUIRE(queue.getQueueList().getInnerQueueList().getOverwrittenCount() == 3);
+	REQUIRE(queue.getQueueList().getQueuedCount() == 2);
+	REQUIRE(queue.getQueueList().getMaxQueuedCount() == 2);
+
+	queue.process();
+	REQUIRE(dataList == std::vector<int>{ 3, 4 });
+	REQUIRE(queue.getQueueList().getQueuedCount() == 0);
+	REQUIRE(queue.getQueueList().getDispatchedCount() == 2);
+}
@@ -0,0 +1,173 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "test.h"
+#include "eventpp/timingwheel.h"
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <utility>
+
+TEST_CASE("TimingWheel, expire in order")
+{
+	eventpp::TimingWheel<int> wheel;
+
+	REQUIRE(wheel.empty());
+
+	wheel.add(5, 5);
+	wheel.add(3, 3);
+	wheel.add(300, 300);
+	wheel.add(70000, 70000);
+	wheel.add(3, 33);
+	REQUIRE(wheel.size() == 5);
+
+	std::vector<int> dataList;
+	auto collect = [&dataList](const int n) {
+		dataList.push_back(n);
+	};
+
+	wheel.advance(2, collect);
+	REQUIRE(dataList.empty());
+
+	wheel.advance(3, collect);
+	REQUIRE(dataList == std::vector<int>{ 3, 33 });
+
+	wheel.advance(299, collect);
+	REQUIRE(dataList == std::vector<int>{ 3, 33, 5 });
+
+	wheel.advance(300, collect);
+	REQUIRE(dataList == std::vector<int>{ 3, 33, 5, 300 });
+
+	wheel.advance(69999, collect);
+	REQUIRE(dataList.size() == 4);
+	REQUIRE(wheel.getNextTick() <= 70000);
+
+	wheel.advance(100000, collect);
+	REQUIRE(dataList == std::vector<int>{ 3, 33, 5, 300, 70000 });
+	REQUIRE(wheel.empty());
+	REQUIRE(wheel.getCurrentTick() == 100000);
+
+	// Not later than the current tick, expire in next advance.
+	wheel.add(10, 10);
+	REQUIRE(wheel.getNextTick() == 100000);
+	wheel.advance(100000, collect);
+	REQUIRE(dataList.back() == 10);
+}
+
+TEST_CASE("TimingWheel, cancel")
+{
+	using SP = std::shared_ptr<int>;
+	std::weak_ptr<int> wp;
+	std::vector<int> dataList;
+	{
+		eventpp::TimingWheel<SP> wheel;
+		auto collect = [&dataList](const SP & sp) {
+			dataList.push_back(*sp);
+		};
+
+		auto handle1 = wheel.add(10, std::make_shared<int>(1));
+		auto handle2 = wheel.add(1000, std::make_shared<int>(2));
+		wheel.add(100000, std::make_shared<int>(3));
+		SP sp = std::make_shared<int>(4);
+		wp = sp;
+		wheel.add(1ull << 40, std::move(sp));
+
+		REQUIRE(wheel.cancel(handle2));
+		REQUIRE(! wheel.cancel(handle2));
+		REQUIRE(wheel.size() == 3);
+
+		wheel.advance(100000, collect);
+		REQUIRE(dataList == std::vector<int>{ 1, 3 });
+		REQUIRE(! wheel.cancel(handle1));
+
+		// The node of handle1 is reused, the stale handle can't cancel the new item.
+		auto handle5 = wheel.add(100001, std::make_shared<int>(5));
+		REQUIRE(! wheel.cancel(handle1));
+		REQUIRE(wheel.cancel(handle5));
+		REQUIRE(! wp.expired());
+	}
+	// The pending items are destroyed with the wheel.
+	REQUIRE(wp.expired());
+}
+
+TEST_CASE("TimingWheel, cancel in advance")
+{
+	eventpp::TimingWheel<int> wheel;
+	using Handle = eventpp::TimingWheel<int>::Handle;
+
+	std::vector<Handle> handleList;
+	for(int i = 0; i < 5; ++i) {
+		handleList.push_back(wheel.add(10, i));
+	}
+	handleList.push_back(wheel.add(20, 5));
+
+	std::vector<int> dataList;
+	wheel.advance(10, [&wheel, &handleList, &dataList](const int n) {
+		dataList.push_back(n);
+		// The item being expired can't be cancelled.
+		REQUIRE(! wheel.cancel(handleList[n]));
+		if(n == 0) {
+			// Cancel the next sibling and the last one in the same slot.
+			REQUIRE(wheel.cancel(handleList[1]));
+			REQUIRE(wheel.cancel(handleList[4]));
+			// The node of item 1 is reused, it must not be expired in this slot.
+			wheel.add(30, 6);
+		}
+		if(n == 2) {
+			REQUIRE(wheel.cancel(handleList[3]));
+			REQUIRE(wheel.cancel(handleList[5]));
+		}
+	});
+	REQUIRE(dataList == std::vector<int>{ 0, 2 });
+	REQUIRE(wheel.size() == 1);
+
+	wheel.advance(30, [&dataList](const int n) {
+		dataList.push_back(n);
+	});
+	REQUIRE(dataList == std::vector<int>{ 0, 2, 6 });
+	REQUIRE(wheel.empty());
+}
+
+TEST_CASE("TimingWheel, random")
+{
+	eventpp::TimingWheel<std::pair<uint64_t, int> > wheel(12345);
+
+	std::mt19937 engine(1);
+	constexpr int itemCount = 10000;
+	std::vector<uint64_t> expireList;
+	for(int i = 0; i < itemCount; ++i) {
+		// Spread over all levels.
+		const uint64_t expireTick = 12345 + (engine() >> (engine() % 32));
+		expireList.push_back(expireTick);
+		wheel.add(expireTick, expireTick, i);
+	}
+	std::sort(expireList.begin(), expireList.end());
+
+	std::vector<uint64_t> resultList;
+	bool correctTick = true;
+	uint64_t tick = 12345;
+	while(! wheel.empty()) {
+		tick = wheel.getNextTick();
+		wheel.advance(tick, [&resultList, &correctTick, tick](const std::pair<uint64_t, int> & item) {
+			if(item.first != tick) {
+				correctTick = false;
+			}
+			resultList.push_back(item.first);
+		});
+	}
+
+	REQUIRE(correctTick);
+	REQUIRE(resultList == expireList);
+}
@@ -0,0 +1,260 @@
+// eventpp library
+// Copyright (C) 2018 Wang Qi (wqking)
+// Github: https://github.com/wqking/eventpp
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//   http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "test.h"
+#include "eventpp/typeddispatcher.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace {
+
+struct MouseEvent
+{
+	int x;
+	int y;
+};
+
+struct KeyEvent
+{
+	int key;
+};
+
+struct TextEvent
+{
+	std::string text;
+};
+
+struct Event
+{
+	int id;
+};
+
+struct OrderEvent : Event
+{
+	int orderId;
+};
+
+struct FillEvent : OrderEvent
+{
+	int quantity;
+};
+
+struct CancelEvent : OrderEvent
+{
+};
+
+} //unnamed namespace
+
+namespace eventpp {
+
+template <>
+struct TypedEventBaseOf<OrderEvent>
+{
+	using Type = Event;
+};
+
+template <>
+struct TypedEventBaseOf<FillEvent>
+{
+	using Type = OrderEvent;
+};
+
+template <>
+struct TypedEventBaseOf<CancelEvent>
+{
+	using Type = OrderEvent;
+};
+
+} //namespace eventpp
+
+TEST_CASE("TypedEventDispatcher, dynamic events")
+{
+	eventpp::TypedEventDispatcher<> dispatcher;
+
+	int mouseX = 0;
+	int key = 0;
+	std::string text;
+
+	dispatcher.appendListener<MouseEvent>([&mouseX](const MouseEvent & e) {
+		mouseX = e.x;
+	});
+	auto keyHandle = dispatcher.appendListener<KeyEvent>([&key](const KeyEvent & e) {
+		key += e.key;
+	});
+	dispatcher.appendListener<TextEvent>([&text](const TextEvent & e) {
+		text = e.text;
+	});
+
+	dispatcher.dispatch(MouseEvent { 3, 5 });
+	dispatcher.dispatch(KeyEvent { 8 });
+	dispatcher.dispatch(TextEvent { "hello" });
+
+	REQUIRE(mouseX == 3);
+	REQUIRE(key == 8);
+	REQUIRE(text == "hello");
+
+	REQUIRE(dispatcher.removeListener<KeyEvent>(keyHandle));
+	REQUIRE(! dispatcher.removeListener<KeyEvent>(keyHandle));
+	dispatcher.dispatch(KeyEvent { 8 });
+	REQUIRE(key == 8);
+}
+
+TEST_CASE("TypedEventDispatcher, static events")
+{
+	eventpp::TypedEventDispatcher<eventpp::TypedEventList<MouseEvent, KeyEvent> > dispatcher;
+
+	std::vector<int> dataList;
+
+	// KeyEvent is static, TextEvent is dynamic.
+	auto handle = dispatcher.appendListener<KeyEvent>([&dataList](const KeyEvent & e) {
+		dataList.push_back(e.key);
+	});
+	dispatcher.prependListener<KeyEvent>([&dataList](const KeyEvent & e) {
+		dataList.push_back(e.key * 10);
+	});
+	dispatcher.insertListener<KeyEvent>([&dataList](const KeyEvent & e) {
+		dataList.push_back(e.key * 100);
+	}, handle);
+	dispatcher.appendListener<TextEvent>([&dataList](const TextEvent & e) {
+		dataList.push_back((int)e.text.size());
+	});
+
+	dispatcher.dispatch(MouseEvent { 1, 2 });
+	dispatcher.dispatch(KeyEvent { 2 });
+	dispatcher.dispatch(TextEvent { "abc" });
+
+	REQUIRE(dataList == std::vector<int>{ 20, 200, 2, 3 });
+
+	int count = 0;
+	dispatcher.forEach<KeyEvent>([&count](const decltype(dispatcher)::Callback<KeyEvent> &) {
+		++count;
+	});
+	REQUIRE(count == 3);
+	REQUIRE(dispatcher.forEachIf<MouseEvent>([](const decltype(dispatcher)::Callback<MouseEvent> &) -> bool {
+		return false;
+	}));
+}
+
+TEST_CASE("TypedEventDispatcher, dispatchers don't share listeners")
+{
+	eventpp::TypedEventDispatcher<> dispatcher1;
+	eventpp::TypedEventDispatcher<> dispatcher2;
+
+	int a = 0;
+	int b = 0;
+	dispatcher1.appendListener<KeyEvent>([&a](const KeyEvent & e) {
+		a += e.key;
+	});
+	dispatcher2.appendListener<MouseEvent>([&b](const MouseEvent & e) {
+		b += e.x;
+	});
+
+	dispatcher1.dispatch(KeyEvent { 1 });
+	dispatcher1.dispatch(MouseEvent { 2, 0 });
+	dispatcher2.dispatch(KeyEvent { 3 });
+	dispatcher2.dispatch(MouseEvent { 4, 0 });
+
+	REQUIRE(a == 1);
+	REQUIRE(b == 4);
+}
+
+TEST_CASE("TypedEventDispatcher, multi threading")
+{
+	eventpp::TypedEventDispatcher<eventpp::TypedEventList<MouseEvent> > dispatcher;
+
+	constexpr int threadCount = 32;
+	constexpr int eventCountPerThread = 1024;
+
+	std::atomic<int> mouseCount(0);
+	std::atomic<int> keyCount(0);
+
+	std::vector<std::thread> threadList;
+	for(int i = 0; i < threadCount; ++i) {
+		threadList.emplace_back([&dispatcher, &mouseCount, &keyCount]() {
+			auto mouseHandle = dispatcher.appendListener<MouseEvent>([&mouseCount](const MouseEvent &) {
+				++mouseCount;
+			});
+			auto keyHandle = dispatcher.appendListener<KeyEvent>([&keyCount](const KeyEvent &) {
+				++keyCount;
+			});
+			for(int k = 0; k < eventCountPerThread; ++k) {
+				dispatcher.dispatch(MouseEvent { k, k });
+				dispatcher.dispatch(KeyEvent { k });
+			}
+			dispatcher.removeListener<MouseEvent>(mouseHandle);
+			dispatcher.removeListener<KeyEvent>(keyHandle);
+		});
+	}
+	for(auto & thread : threadList) {
+		thread.join();
+	}
+
+	REQUIRE(mouseCount.load() >= threadCount * eventCountPerThread);
+	REQUIRE(keyCount.load() >= threadCount * eventCountPerThread);
+}
+
+template <typename Dispatcher>
+void testTypedEventHierarchy(Dispatcher & dispatcher)
+{
+	std::vector<std::string> received;
+
+	dispatcher.template appendListener<Event>([&received](const Event & e) {
+		received.push_back("Event" + std::to_string(e.id));
+	});
+	dispatcher.template appendListener<FillEvent>([&received](const FillEvent & e) {
+		received.push_back("Fill" + std::to_string(e.quantity));
+	});
+	auto orderHandle = dispatcher.template appendListener<OrderEvent>([&received](const OrderEvent & e) {
+		received.push_back("Order" + std::to_string(e.orderId));
+	});
+
+	FillEvent fill;
+	fill.id = 1;
+	fill.orderId = 2;
+	fill.quantity = 3;
+	dispatcher.dispatch(fill);
+	REQUIRE(received == std::vector<std::string>{ "Fill3", "Order2", "Event1" });
+
+	// CancelEvent has no listeners on its own.
+	received.clear();
+	CancelEvent cancel;
+	cancel.id = 4;
+	cancel.orderId = 5;
+	dispatcher.dispatch(cancel);
+	REQUIRE(received == std::vector<std::string>{ "Order5", "Event4" });
+
+	// The static type is used
+	received.clear();
+	dispatcher.dispatch(static_cast<const Event &>(fill));
+	REQUIRE(received == std::vector<std::string>{ "Event1" });
+
+	received.clear();
+	dispatcher.template removeListener<OrderEvent>(orderHandle);
+	dispatcher.dispatch(fill);
+	REQUIRE(received == std::vector<std::string>{ "Fill3", "Event1" });
+}
+
+TEST_CASE("TypedEventDispatcher, event hierarchy, dynamic events")
+{
+	eventpp::TypedEventDispatcher<> dispatcher;
+	testTypedEventHierarchy(dispatcher);
+}
+
+TEST_CASE("TypedEventDispatcher, event hierarchy, static events")
+{
+	eventpp::TypedEventDispatcher<eventpp::TypedEventList<Event, FillEvent> > dispatcher;
+	testTypedEventHierarchy(dispatcher);
+}